@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "Parser.h"
+#include "DFA.h"
+#include "AhoCorasick.h"
+
+// alternations of literals: Aho-Corasick vs the DFA, build time, table size and search
+
+struct DFABench {
+    template<typename F>
+    static double time_ms(F f, int rounds) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) f();
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double,std::milli>(t1 - t0).count() / rounds;
+    }
+
+    static void run(size_t n, const std::string& text) {
+        std::mt19937 rng(n);
+        std::string expr;
+        for (size_t i = 0; i < n; i++) {
+            if (i) expr += "|";
+            int k = 4 + rng() % 7;
+            for (int j = 0; j < k; j++) expr += 'a' + rng() % 26;
+        }
+        auto root = regex_parse(expr);
+        NFA nfa(false);
+        nfa.generate(root.get(), false);
+
+        std::unique_ptr<DFA> dfa;
+        std::unique_ptr<AhoCorasick> ac;
+        // the first search builds the reversed DFA as well
+        const std::string& word = nfa.get_literals().words[0];
+        double dfa_build = time_ms([&] {
+            dfa = std::make_unique<DFA>(&nfa);
+            dfa->generate();
+            dfa->find_all(word);
+        }, 1);
+        double ac_build = time_ms([&] { ac = std::make_unique<AhoCorasick>(nfa.get_literals().words); }, 1);
+        const DFATable& t = dfa->get_table();
+        size_t dfa_bytes = t.trans.size() * sizeof(uint32_t) + t.flags.size();
+        const DFATable& r = dfa->rdfa->get_table();
+        dfa_bytes += r.trans.size() * sizeof(uint32_t) + r.flags.size();
+
+        size_t a = 0, b = 0;
+        double dfa_scan = time_ms([&] { a = dfa->find_all(text).size(); }, 1);
+        double ac_scan = time_ms([&] { b = ac->find_all(text).size(); }, 1);
+        if (a != b) printf("find_all mismatch with %zu words\n", n);
+
+        double mb = text.size() / 1e6;
+        printf("%6zu %8zu %10.1f %10.1f %10zu %10zu %10.1f %10.1f\n", n, a, dfa_build, ac_build,
+            dfa_bytes >> 10, ac->memory() >> 10, mb / dfa_scan * 1e3, mb / ac_scan * 1e3);
+    }
+};
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {16, 256, 1024, 4096};
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; i++) sizes.push_back(std::stoul(argv[i]));
+    }
+
+    std::mt19937 rng(1);
+    std::string text;
+    while (text.size() < (4 << 20)) {
+        int k = 2 + rng() % 8;
+        for (int i = 0; i < k; i++) text += 'a' + rng() % 26;
+        text += ' ';
+    }
+
+    printf("%6s %8s %10s %10s %10s %10s %10s %10s\n", "words", "matches", "dfa(ms)", "ac(ms)",
+        "dfa(KB)", "ac(KB)", "dfa MB/s", "ac MB/s");
+    for (size_t n : sizes) {
+        DFABench::run(n, text);
+    }
+    return 0;
+}
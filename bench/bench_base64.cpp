@@ -0,0 +1,114 @@
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "base64.h"
+
+// Base64 of SVG payloads: lookup tables vs the former per char encoder
+
+struct Base64Bench {
+    // the former base64_encode() and base64_decode(), kept as the baseline
+    static char legacy_char(int index) {
+        if (index < 0 || index >= 64) {
+            throw std::invalid_argument("invalid Base64 index: " + std::to_string(index));
+        }
+        return BASE64_TABLE[index];
+    }
+
+    static int legacy_index(char c) {
+        const char* pos = std::strchr(BASE64_TABLE, c);
+        if (pos != nullptr) return pos - BASE64_TABLE;
+        if (c == '=') return -1;
+        throw std::invalid_argument("invalid Base64 char");
+    }
+
+    static std::string legacy_encode(const std::string& input) {
+        std::string output;
+        int input_len = input.size();
+        int i = 0;
+        while (i < input_len) {
+            unsigned char byte1 = (i < input_len) ? input[i++] : 0;
+            unsigned char byte2 = (i < input_len) ? input[i++] : 0;
+            unsigned char byte3 = (i < input_len) ? input[i++] : 0;
+            int idx1 = (byte1 >> 2) & 0x3F;
+            int idx2 = ((byte1 & 0x03) << 4) | ((byte2 >> 4) & 0x0F);
+            int idx3 = ((byte2 & 0x0F) << 2) | ((byte3 >> 6) & 0x03);
+            int idx4 = byte3 & 0x3F;
+            output += legacy_char(idx1);
+            output += legacy_char(idx2);
+            output += (i - 3 < input_len - 2) ? legacy_char(idx3) : '=';
+            output += (i - 3 < input_len - 1) ? legacy_char(idx4) : '=';
+        }
+        return output;
+    }
+
+    static std::string legacy_decode(const std::string& input) {
+        std::string output;
+        std::string filtered;
+        for (char c : input) {
+            if (std::isalnum(c) || c == '+' || c == '/' || c == '=') filtered += c;
+        }
+        output.reserve(filtered.size() / 4 * 3);
+        for (size_t i = 0; i + 4 <= filtered.size(); i += 4) {
+            int idx1 = legacy_index(filtered[i]);
+            int idx2 = legacy_index(filtered[i+1]);
+            int idx3 = legacy_index(filtered[i+2]);
+            int idx4 = legacy_index(filtered[i+3]);
+            if (idx3 == -1) idx3 = 0;
+            if (idx4 == -1) idx4 = 0;
+            output += (unsigned char)((idx1 << 2) | (idx2 >> 4));
+            if (filtered[i+2] != '=') output += (unsigned char)(((idx2 & 0x0F) << 4) | (idx3 >> 2));
+            if (filtered[i+3] != '=') output += (unsigned char)(((idx3 & 0x03) << 6) | idx4);
+        }
+        return output;
+    }
+
+    template<typename F>
+    static double time_ms(F f, int rounds) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) f();
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double,std::milli>(t1 - t0).count() / rounds;
+    }
+
+    static void run(size_t size, int rounds) {
+        // svg-ish text: mostly ascii with some multibyte box drawing chars
+        std::mt19937 rng(size);
+        const char* words[] = {"<text x=\"12\" y=\"40\">", "</text>\n", "\xe2\x94\x80", "\xe2\x94\x82", "fill=\"#333\"", " "};
+        std::string raw;
+        while (raw.size() < size) raw += words[rng() % 6];
+        // the former encoder wrote 'A' instead of '=' padding, compare whole blocks only
+        raw.resize(size / 3 * 3);
+
+        std::string a, b;
+        double enc_legacy = time_ms([&] { a = legacy_encode(raw); }, rounds);
+        double enc_table = time_ms([&] { b = base64_encode(raw); }, rounds);
+        if (a != b) printf("encode mismatch at %zu bytes\n", size);
+        std::string c, d;
+        double dec_legacy = time_ms([&] { c = legacy_decode(a); }, rounds);
+        double dec_table = time_ms([&] { d = base64_decode(a); }, rounds);
+        if (c != raw || d != raw) printf("decode mismatch at %zu bytes\n", size);
+
+        double mb = size / 1e6;
+        printf("%10zu %12.1f %12.1f %8.1fx %12.1f %12.1f %8.1fx\n", size,
+            mb / enc_legacy * 1e3, mb / enc_table * 1e3, enc_legacy / enc_table,
+            mb / dec_legacy * 1e3, mb / dec_table * 1e3, dec_legacy / dec_table);
+    }
+};
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {1 << 10, 64 << 10, 1 << 20, 16 << 20};
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; i++) sizes.push_back(std::stoul(argv[i]));
+    }
+    printf("%10s %12s %12s %9s %12s %12s %9s\n", "bytes", "enc old MB/s", "enc new MB/s",
+        "speedup", "dec old MB/s", "dec new MB/s", "speedup");
+    for (size_t size : sizes) {
+        Base64Bench::run(size, size < (1 << 20) ? 200 : 5);
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+#include "RegexSet.h"
+#include "DFAFile.h"
+
+// rule sets at process start: compiling the patterns vs mapping a saved image
+
+struct DFABench {
+    template<typename F>
+    static double time_ms(F f, int rounds) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) f();
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double,std::milli>(t1 - t0).count() / rounds;
+    }
+
+    static void run(size_t n, const std::string& text) {
+        std::mt19937 rng(n);
+        std::vector<std::string> patterns;
+        for (size_t i = 0; i < n; i++) {
+            std::string p;
+            int k = 3 + rng() % 6;
+            for (int j = 0; j < k; j++) p += 'a' + rng() % 26;
+            if (rng() % 2) p += "\\d+";
+            patterns.push_back(p);
+        }
+
+        RegexSet set;
+        double compile = time_ms([&] {
+            set = RegexSet();
+            for (auto& p : patterns) set.add(p);
+            set.compile();
+        }, 1);
+        std::string path = "/tmp/bench_dfa_file.dfa";
+        {
+            std::ofstream os(path, std::ios::binary);
+            set.save(os);
+        }
+        std::unique_ptr<MappedDFA> mapped;
+        double load = time_ms([&] { mapped = std::make_unique<MappedDFA>(path); }, 5);
+
+        size_t a = 0, b = 0;
+        double scan = time_ms([&] { a = set.matches(text).size(); }, 3);
+        double mapped_scan = time_ms([&] { b = mapped->matches(text).size(); }, 3);
+        if (a != b) printf("matches mismatch with %zu patterns\n", n);
+
+        std::ifstream is(path, std::ios::binary | std::ios::ate);
+        double mb = text.size() / 1e6;
+        printf("%8zu %8zu %10zu %12.1f %10.2f %10.1f %10.1f\n", n, mapped->states(),
+            (size_t)is.tellg() >> 10, compile, load, mb / scan * 1e3, mb / mapped_scan * 1e3);
+        std::remove(path.c_str());
+    }
+};
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {100, 1000, 3000};
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; i++) sizes.push_back(std::stoul(argv[i]));
+    }
+
+    // upper case text, so no pattern matches and the whole text is scanned
+    std::mt19937 rng(1);
+    std::string text;
+    while (text.size() < (1 << 20)) {
+        text += 'A' + rng() % 26;
+    }
+
+    printf("%8s %8s %10s %12s %10s %10s %10s\n", "patterns", "states", "image(KB)", "compile(ms)",
+        "map(ms)", "MB/s", "mapped MB/s");
+    for (size_t n : sizes) {
+        DFABench::run(n, text);
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <chrono>
+#include <cstdio>
+#include <queue>
+
+#include "Parser.h"
+#include "DFA.h"
+
+// DFA minimization: Hopcroft partition refinement vs the former queue refinement
+
+struct DFABench {
+    // the former DFA::simplify() refinement, kept as the baseline
+    static std::vector<State> legacy_partition(DFA& d) {
+        std::map<int,std::vector<State>> groups;
+        for (State s = 0; s < d.dfa.size(); s++) {
+            if (!d.is_valid(s)) continue;
+            groups[d.terminals.count(s) + 2 * d.eot_terminals.count(s)].push_back(s);
+        }
+        std::unordered_map<State,size_t> setid;
+        setid[INVALID_STATE] = INVALID_STATE;
+        std::queue<std::vector<State>> equiv_sets;
+        for (auto& [k, g] : groups) {
+            for (State s : g) {
+                setid[s] = g[0];
+            }
+            equiv_sets.push(g);
+        }
+
+        size_t ntok = d.get_tokens().size();
+        std::vector<std::vector<State>> nexts(d.dfa.size(), std::vector<State>(ntok, INVALID_STATE));
+        for (State s : d.valids) {
+            for (auto [tok, next] : d.dfa[s]) {
+                nexts[s][tok] = d.is_valid(next) ? next : INVALID_STATE;
+            }
+        }
+        auto next_equal = [&](State a, State b) {
+            for (size_t i = 0; i < ntok; i++) {
+                if (setid[nexts[a][i]] != setid[nexts[b][i]]) return false;
+            }
+            return true;
+        };
+
+        while (!equiv_sets.empty()) {
+            auto vec = equiv_sets.front();
+            equiv_sets.pop();
+            if (vec.size() <= 1) continue;
+
+            std::vector<std::pair<State,std::vector<State>>> mp;
+            for (State s : vec) {
+                bool found = false;
+                for (auto& [x, p] : mp) {
+                    if (next_equal(s, x)) {
+                        p.push_back(s);
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found) mp.emplace_back(s, std::vector<State>{s});
+            }
+            if (mp.size() > 1) {
+                for (auto& [x, xs] : mp) {
+                    equiv_sets.push(xs);
+                    for (auto y : xs) setid[y] = x;
+                }
+            }
+        }
+
+        std::vector<State> res(d.dfa.size(), INVALID_STATE);
+        for (State s : d.valids) {
+            res[s] = setid[s];
+        }
+        return res;
+    }
+
+    static size_t blocks(const std::vector<State>& setid) {
+        size_t n = 0;
+        for (State s = 0; s < setid.size(); s++) {
+            if (setid[s] == s) n++;
+        }
+        return n;
+    }
+
+    template<typename F>
+    static double time_ms(F f, int rounds) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) f();
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double,std::milli>(t1 - t0).count() / rounds;
+    }
+
+    static void run(const std::string& expr, int rounds) {
+        auto root = regex_parse(expr);
+        NFA nfa(false);
+        nfa.generate(root.get(), false);
+        DFA d(&nfa);
+        d.nfa_to_dfa();
+        d.prune();
+
+        size_t a = 0, b = 0;
+        double legacy = time_ms([&] { a = blocks(legacy_partition(d)); }, rounds);
+        double hopcroft = time_ms([&] { b = blocks(d.partition()); }, rounds);
+        printf("%-28s %8zu %8zu %8zu %12.3f %12.3f %8.1fx\n", expr.c_str(), d.valids.size(),
+            a, b, legacy, hopcroft, legacy / hopcroft);
+    }
+};
+
+int main(int argc, char** argv) {
+    std::vector<std::string> exprs = {
+        "(a[ab]c|b[bc]c|c[ac]c)",
+        "(ab|ac|ba|bc|ca|cb){2,4}",
+        "[a-z]{1,40}x[0-9]{1,30}",
+        "(a|b)*a(a|b){8}",
+        "(a|b)*a(a|b){12}",
+        "a{2000}",
+        "[a-c]{1,1000}x",
+        "(ab|cd){500}",
+    };
+    if (argc > 1) {
+        exprs.assign(argv + 1, argv + argc);
+    }
+
+    printf("%-28s %8s %8s %8s %12s %12s %9s\n", "regex", "states", "legacy", "hopcroft",
+        "legacy(ms)", "hopcroft(ms)", "speedup");
+    for (auto& expr : exprs) {
+        DFABench::run(expr, 3);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "Parser.h"
+#include "DFA.h"
+
+// one search after another over the text, as highlighting does: backward start scans
+// from the end of text vs windows growing from the search position
+
+struct DFABench {
+    template<typename F>
+    static double time_ms(F f, int rounds) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) f();
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double,std::milli>(t1 - t0).count() / rounds;
+    }
+
+    static void run(const std::string& expr, const std::string& text) {
+        auto root = regex_parse(expr);
+        NFA nfa(false);
+        nfa.generate(root.get(), false);
+        DFA d(&nfa);
+        d.generate();
+        // builds the reversed DFA
+        d.leftmost(text, text.size(), nullptr);
+
+        size_t a = 0, b = 0;
+        double whole = time_ms([&] {
+            for (size_t pos = 0; pos <= text.size(); a++) {
+                size_t start = d.scan_back(text, pos, text.size(), nullptr);
+                if (start == NO_MATCH) break;
+                pos = after_match({start, d.longest(text, start)});
+            }
+        }, 1);
+        Match m;
+        double windows = time_ms([&] {
+            for (size_t pos = 0; pos <= text.size() && d.search(text, m, pos); b++) {
+                pos = after_match(m);
+            }
+        }, 1);
+        if (a != b) printf("match count mismatch on %s\n", expr.c_str());
+
+        double mb = text.size() / 1e6;
+        printf("%-30s %8zu %8zd %12.1f %12.1f %8.1fx\n", expr.c_str(), b, (ssize_t)nfa.max_length(),
+            mb / whole * 1e3, mb / windows * 1e3, whole / windows);
+    }
+};
+
+int main(int argc, char** argv) {
+    std::vector<std::string> exprs = {
+        "[a-z]{2}[0-9]{3}-",
+        "[a-z]+[0-9]{3}-",
+        "[a-z][0-9a-z]{0,15}-[0-9]{4}",
+        "[^ ]{40}",
+    };
+    if (argc > 1) {
+        exprs.assign(argv + 1, argv + argc);
+    }
+
+    // lower case words, a phone number about every 2 KB. No pattern has prefixes for the
+    // prefilter, which would find the matches forward
+    std::mt19937 rng(1);
+    std::string text;
+    while (text.size() < (1 << 20)) {
+        int k = 2 + rng() % 8;
+        for (int i = 0; i < k; i++) text += 'a' + rng() % 26;
+        text += ' ';
+        if (rng() % 300 == 0) text += "ab555-0199 ";
+    }
+
+    printf("%-30s %8s %8s %12s %12s %9s\n", "regex", "matches", "max len", "whole MB/s",
+        "window MB/s", "speedup");
+    for (auto& expr : exprs) {
+        DFABench::run(expr, text);
+    }
+    return 0;
+}
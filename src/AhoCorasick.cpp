@@ -0,0 +1,189 @@
+#include <queue>
+#include "AhoCorasick.h"
+
+AhoCorasick::AhoCorasick(const std::vector<std::string>& words) {
+    // plain trie first, children sorted by byte
+    struct Node {
+        std::vector<std::pair<uint8_t,uint32_t>> kids;
+        bool word = false;
+    };
+    std::vector<Node> trie(1);
+    for (auto& w : words) {
+        if (w.empty()) {
+            throw std::invalid_argument("AhoCorasick: empty word");
+        }
+        uint32_t s = 0;
+        for (unsigned char c : w) {
+            auto& kids = trie[s].kids;
+            auto it = std::lower_bound(kids.begin(), kids.end(), std::make_pair(c, (uint32_t)0));
+            if (it == kids.end() || it->first != c) {
+                uint32_t t = trie.size();
+                kids.insert(it, {c, t});
+                trie.emplace_back();
+                s = t;
+            } else {
+                s = it->second;
+            }
+        }
+        trie[s].word = true;
+        first_bytes[(uint8_t)w[0]] = true;
+        max_len = std::max(max_len, w.size());
+    }
+
+    // place the children of each node at base + byte in the first gap that holds them all
+    std::vector<uint32_t> skip;     // skip[i] == i for a free slot, else leads to a later one
+    auto grow = [&](size_t n) {
+        while (depth.size() < n) {
+            skip.push_back(depth.size());
+            base.push_back(0);
+            check.push_back(NONE);
+            depth.push_back(NONE);
+        }
+    };
+    auto next_free = [&](uint32_t i) {
+        grow(i + 1);
+        uint32_t r = i;
+        while (skip[r] != r) {
+            r = skip[r];
+            grow(r + 1);
+        }
+        while (skip[i] != i) {
+            uint32_t j = skip[i];
+            skip[i] = r;
+            i = j;
+        }
+        return r;
+    };
+    nodes = trie.size();
+    std::vector<uint32_t> slot(nodes, 0);
+    grow(1);
+    depth[0] = 0;
+    skip[0] = 1;
+    std::queue<uint32_t> q;
+    q.push(0);
+    while (!q.empty()) {
+        uint32_t u = q.front(); q.pop();
+        auto& kids = trie[u].kids;
+        if (kids.empty()) continue;
+        // the first child tries each free slot in turn
+        uint32_t b;
+        for (uint32_t i = next_free(kids[0].first);; i = next_free(i + 1)) {
+            b = i - kids[0].first;
+            grow(b + kids.back().first + 1);
+            bool ok = true;
+            for (auto [c, v] : kids) {
+                if (depth[b + c] != NONE) {
+                    ok = false;
+                    break;
+                }
+            }
+            if (ok) break;
+        }
+        uint32_t s = slot[u];
+        base[s] = b;
+        for (auto [c, v] : kids) {
+            check[b + c] = s;
+            depth[b + c] = depth[s] + 1;
+            skip[b + c] = b + c + 1;
+            slot[v] = b + c;
+            q.push(v);
+        }
+    }
+
+    // failure links in breadth first order, shallower states are done before
+    size_t n = depth.size();
+    fail.assign(n, 0);
+    out.assign(n, 0);
+    next_out.assign(n, 0);
+    q.push(0);
+    while (!q.empty()) {
+        uint32_t u = q.front(); q.pop();
+        uint32_t s = slot[u];
+        for (auto [c, v] : trie[u].kids) {
+            uint32_t t = slot[v];
+            fail[t] = s == 0 ? 0 : step(fail[s], c);
+            next_out[t] = out[fail[t]];
+            out[t] = trie[v].word ? t : next_out[t];
+            q.push(v);
+        }
+    }
+}
+
+size_t AhoCorasick::memory() const {
+    return (base.size() + check.size() + fail.size() + out.size() + next_out.size() + depth.size())
+        * sizeof(uint32_t);
+}
+
+uint32_t AhoCorasick::child(uint32_t s, uint8_t c) const {
+    uint32_t t = base[s] + c;
+    return t < check.size() && check[t] == s ? t : NONE;
+}
+
+// goto or follow the failure links, the root stays on a byte no word starts with
+uint32_t AhoCorasick::step(uint32_t s, uint8_t c) const {
+    while (true) {
+        uint32_t t = child(s, c);
+        if (t != NONE) return t;
+        if (s == 0) return 0;
+        s = fail[s];
+    }
+}
+
+size_t AhoCorasick::scan(std::string_view text, size_t pos, std::vector<bool>* marks) const {
+    const unsigned char* p = (const unsigned char*)text.data();
+    const size_t n = text.size();
+    size_t best = NO_MATCH;
+    uint32_t s = 0;
+    for (size_t i = pos; i < n; i++) {
+        if (s == 0) {
+            while (i < n && !first_bytes[p[i]]) i++;
+            if (i == n) break;
+        }
+        s = step(s, p[i]);
+        if (!out[s]) continue;
+        // the longest word ending here starts first
+        best = std::min(best, i + 1 - depth[out[s]]);
+        if (marks) {
+            for (uint32_t w = out[s]; w; w = next_out[w]) {
+                (*marks)[i + 1 - depth[w]] = true;
+            }
+        } else if (i + 2 >= best + max_len) {
+            // words ending later start after best
+            break;
+        }
+    }
+    return best;
+}
+
+size_t AhoCorasick::first(std::string_view text, size_t pos) const {
+    return scan(text, pos, nullptr);
+}
+
+size_t AhoCorasick::leftmost(std::string_view text, size_t pos, std::vector<bool>* marks) {
+    return scan(text, pos, marks);
+}
+
+size_t AhoCorasick::longest(std::string_view text, size_t pos) {
+    size_t end = NO_MATCH;
+    uint32_t s = 0;
+    for (size_t i = pos; i < text.size(); i++) {
+        s = child(s, text[i]);
+        if (s == NONE) break;
+        if (out[s] == s) end = i + 1;
+    }
+    return end;
+}
+
+bool AhoCorasick::match(std::string_view text) {
+    return longest(text, 0) == text.size();
+}
+
+std::unique_ptr<LongestMatcher> make_matcher(NFA* nfa) {
+    const Literals& lits = nfa->get_literals();
+    if (!lits.words.empty()) {
+        return std::make_unique<AhoCorasick>(lits.words);
+    }
+    auto dfa = std::make_unique<DFA>(nfa);
+    dfa->generate();
+    return dfa;
+}
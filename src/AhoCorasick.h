@@ -0,0 +1,50 @@
+#ifndef __AHO_CORASICK_H__
+#define __AHO_CORASICK_H__
+
+#include "DFA.h"
+
+// matcher of a set of literal strings, a trie in double-array form with failure links.
+// Same leftmost-longest semantics as DFA, built in time linear in the size of the words
+class AhoCorasick: public LongestMatcher {
+public:
+    AhoCorasick(const std::vector<std::string>& words);
+
+    // whole text is one of the words
+    bool match(std::string_view text);
+    // start of the leftmost occurrence of a word at or after pos, NO_MATCH if none
+    size_t first(std::string_view text, size_t pos) const;
+
+    // nodes of the trie
+    size_t states() const {
+        return nodes;
+    }
+
+    // bytes of the arrays
+    size_t memory() const;
+
+private:
+    uint32_t child(uint32_t s, uint8_t c) const;
+    uint32_t step(uint32_t s, uint8_t c) const;
+    size_t scan(std::string_view text, size_t pos, std::vector<bool>* marks) const;
+    size_t leftmost(std::string_view text, size_t pos, std::vector<bool>* marks);
+    size_t longest(std::string_view text, size_t pos);
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // child of s on byte c is t = base[s] + c if check[t] == s, the root is 0
+    std::vector<uint32_t> base;
+    std::vector<uint32_t> check;
+    std::vector<uint32_t> fail;     // longest proper suffix in the trie
+    std::vector<uint32_t> out;      // longest suffix that is a word, itself included, 0 if none
+    std::vector<uint32_t> next_out; // next shorter word on the failure path, 0 if none
+    std::vector<uint32_t> depth;    // length of the string of the state, NONE for a free slot
+    bool first_bytes[256] = {false};
+    size_t max_len = 0;
+    size_t nodes = 0;
+};
+
+// engine for nfa: Aho-Corasick if the expression is an alternation of literals, else a DFA
+std::unique_ptr<LongestMatcher> make_matcher(NFA* nfa);
+
+#endif // __AHO_CORASICK_H__
@@ -0,0 +1,162 @@
+#include <deque>
+#include <sstream>
+#include "Batch.h"
+#include "unicode.h"
+#include "GraphBox.h"
+#include "DFA.h"
+#include "DFACanvas.h"
+#include "DFACode.h"
+#include "DFAFile.h"
+#include "RegexSet.h"
+#include "GraphSvg.h"
+#include "GraphHtml.h"
+#include "ThreadPool.h"
+
+void dump_expr(std::ostream& os, ExprRoot* root, const Utils::Args& args) {
+    std::string expr_str = root->stringify(args.color);
+
+    reset_color();
+    std::unique_ptr<RootBox> box(expr_to_box(root));
+
+    // html, svg, xml, cpp and dfabin are exclusive
+    if (args.format & Utils::FMT_HTML) {
+        std::stringstream html_os;
+        box->dump(html_os);
+        GraphHtml html(expr_str, html_os.str());
+        html.dump(os);
+        return;
+    } else if (args.format & Utils::FMT_SVG) {
+        GraphSvg svg(expr_str, box->get_rows());
+        svg.dump(os);
+        return;
+    } else if (args.format & Utils::FMT_XML) {
+        os << root->xml() << std::endl;
+        return;
+    } else if (args.format & Utils::FMT_CPP) {
+        NFA nfa(false);
+        nfa.generate(root, args.utf8);
+        DFA dfa(&nfa);
+        dfa.generate();
+        DFACode code(&dfa, root->stringify(false));
+        code.dump(os);
+        return;
+    } else if (args.format & Utils::FMT_DFABIN) {
+        NFA nfa(false);
+        nfa.generate(root, args.utf8);
+        DFA dfa(&nfa);
+        dfa.generate();
+        write_dfa_file(os, dfa.get_table(), &dfa.get_reversed_table(), nfa.max_length());
+        return;
+    }
+
+    os << "Regular Expression: " << expr_str << std::endl;
+
+    if (args.format & Utils::FMT_TREE) {
+        os << root->format(4, args.color) << std::endl;
+    } 
+
+    if (args.format & Utils::FMT_GRAPH) {
+        box->dump(os);
+    }
+
+    if (args.format & Utils::FMT_NFA) {
+        NFA nfa(args.color);
+        nfa.generate(root, args.utf8);
+        nfa.dump(os);
+    }
+
+    if (args.format & Utils::FMT_DFA) {
+        NFA nfa(args.color);
+        nfa.generate(root, args.utf8);
+
+        DFA dfa(&nfa);
+        dfa.generate();
+        dfa.dump(os);
+
+        DFACanvas t(&dfa);
+        t.render();
+        t.dump(os);
+    } 
+}
+
+// the non-empty lines as one pattern set, pattern i is the i-th of them.
+// nothing is written if a line fails to parse
+static int save_set(std::istream& is, std::ostream& os, std::ostream& es, const Utils::Args& args) {
+    RegexSet set(false, args.utf8);
+    std::string line;
+    size_t lineno = 0;
+    int failed = 0;
+    while (getline(is, line)) {
+        lineno++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        try {
+            set.add(line);
+        } catch (const std::exception& e) {
+            std::string msg = e.what();
+            es << "Error: line " << lineno << ": " << msg.substr(0, msg.find('\n')) << std::endl;
+            failed++;
+        }
+    }
+    if (failed) return 1;
+    set.compile();
+    set.save(os);
+    return 0;
+}
+
+int run_batch(std::istream& is, std::ostream& os, std::ostream& es, const Utils::Args& args) {
+    if (args.format & Utils::FMT_DFABIN) {
+        return save_set(is, os, es, args);
+    }
+
+    struct Result {
+        std::string out;
+        std::string err;
+    };
+
+    ThreadPool pool(args.jobs);
+    // bound the tasks in flight, so ordered output doesn't buffer every result
+    const size_t window = pool.size() * 64;
+    std::deque<std::pair<size_t,std::future<Result>>> pending;
+    size_t lineno = 0;
+    int failed = 0;
+
+    auto flush = [&](size_t n) {
+        while (pending.size() > n) {
+            auto& [no, fut] = pending.front();
+            Result res = fut.get();
+            if (res.err.empty()) {
+                os << res.out;
+            } else {
+                es << "Error: line " << no << ": " << res.err << std::endl;
+                failed++;
+            }
+            pending.pop_front();
+        }
+    };
+
+    std::string line;
+    while (getline(is, line)) {
+        lineno++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        pending.emplace_back(lineno, pool.submit([line, &args]() {
+            Result res;
+            try {
+                std::unique_ptr<ExprRoot> root(regex_parse(utf8_to_uhhhh(line), false, false));
+                std::stringstream ss;
+                dump_expr(ss, root.get(), args);
+                res.out = ss.str();
+            } catch (const std::exception& e) {
+                std::string msg = e.what();
+                res.err = msg.substr(0, msg.find('\n'));
+            }
+            return res;
+        }));
+        flush(window);
+    }
+    flush(0);
+
+    LOG_DEBUG("batch: %zu lines, %d failed", lineno, failed);
+    return failed? 1 : 0;
+}
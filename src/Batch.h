@@ -0,0 +1,20 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <iostream>
+#include "utils.h"
+#include "Parser.h"
+
+// write the outputs selected by args.format
+void dump_expr(std::ostream& os, ExprRoot* root, const Utils::Args& args);
+
+/*
+    each input line is a separate expression, parsed and rendered by a pool of threads.
+    results are written to os in input order, a failed line is reported to es and skipped.
+    return 1 if any line failed.
+    with the dfabin format, the lines are compiled into one RegexSet and its image is
+    written instead.
+*/
+int run_batch(std::istream& is, std::ostream& os, std::ostream& es, const Utils::Args& args);
+
+#endif // __BATCH_H__
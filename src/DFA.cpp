@@ -12,40 +12,309 @@ static std::string special_token(const std::string& s) {
     return "(" + s + ")";
 }
 
+// code point of a single char spec: "a", "\\.", "\\xHH", "\\uHHHH", "\\0oo", "\\cX", "\\n" ...
+static uint32_t char_code(const std::string& s) {
+    if (s.size() == 1) return (unsigned char)s[0];
+    if (s[0] != '\\') return utf8_to_unicode(s.data(), s.size()).first;
+    char c = s[1];
+    if (s.size() == 4 && c == 'x') return std::stoul(s.substr(2), nullptr, 16);
+    if (s.size() == 6 && c == 'u') return std::stoul(s.substr(2), nullptr, 16);
+    if (s.size() == 10 && c == 'U') return std::stoul(s.substr(2), nullptr, 16);
+    if (s.size() == 4 && c == '0') return std::stoul(s.substr(2), nullptr, 8);
+    if (s.size() == 3 && c == 'c') return s[2] & 0x1F;
+    switch (c) {
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 't': return '\t';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        case '0': return 0;
+        default: return (unsigned char)c;
+    }
+}
+
+// \uHHHH, \UHHHHHHHH and raw multibyte chars are always utf-8 encoded
+static bool is_wide(const std::string& s) {
+    if (s.size() > 1 && s[0] != '\\') return true;
+    return s.size() > 2 && (s[1] == 'u' || s[1] == 'U');
+}
+
+// complement of the ranges in [0, max]
+static CharRanges negate(CharRanges chars, uint32_t max) {
+    std::sort(chars.begin(), chars.end());
+    CharRanges res;
+    uint32_t lo = 0;
+    for (auto [a, b] : chars) {
+        if (a > max) break;
+        if (a > lo) res.emplace_back(lo, a - 1);
+        lo = std::max(lo, b + 1);
+    }
+    if (lo <= max) res.emplace_back(lo, max);
+    return res;
+}
+
+// chars of an escaped node: "\\d", "\\W", "\\n", "\\x41", "\\u4E00" ...
+static CharRanges escaped_chars(const std::string& ch, uint32_t max) {
+    static const CharRanges digit = {{'0', '9'}};
+    static const CharRanges word = {{'0', '9'}, {'A', 'Z'}, {'_', '_'}, {'a', 'z'}};
+    static const CharRanges space = {{'\t', '\r'}, {' ', ' '}};
+    if (ch == "\\d") return digit;
+    if (ch == "\\D") return negate(digit, max);
+    if (ch == "\\w") return word;
+    if (ch == "\\W") return negate(word, max);
+    if (ch == "\\s") return space;
+    if (ch == "\\S") return negate(space, max);
+    uint32_t c = char_code(ch);
+    return {{c, c}};
+}
+
+// display name of a byte in class tokens
+static std::string byte_name(uint8_t c) {
+    switch (c) {
+        case '\n': return "\\n";
+        case '\r': return "\\r";
+        case '\t': return "\\t";
+        default: break;
+    }
+    if (c > ' ' && c < 0x7F) return std::string(1, c);
+    char buf[8];
+    snprintf(buf, sizeof(buf), "\\x%02X", c);
+    return buf;
+}
+
 Token NFA::tok_epsilon = 0;
 State NFA::state_initial = 0;
 State NFA::state_final = 1;
 
-NFA::NFA(bool color): color(color) {
-    tokenId[EPSILON] = TOK_EPSILON;
+NFA::NFA(bool color): color(color), utf8(false) {
     tokens.push_back(EPSILON);
+    tokens.push_back(special_token("^"));
+    tokens.push_back(special_token("$"));
+    std::fill(byte_token, byte_token + 256, INVALID_TOKEN);
 
-    nfa.push_back({}); // start state
-    nfa.push_back({}); // end state
+    saves.assign(2, -1); // start state, end state
+    group_names.push_back("");
 }
 
-State NFA::new_state() {
-    State s = nfa.size();
-    nfa.push_back({});
+State NFA::new_state(int save) {
+    State s = saves.size();
+    saves.push_back(save);
     return s;
 }
 
 void NFA::add_jump(State a, Token t, State b) {
-    nfa[a][t].insert(b);
+    jumps.push_back({(uint32_t)a, (uint32_t)t, (uint32_t)b});
 };
 
+// compress the edges into rows by state, the epsilon edges keep their order
+void NFA::finalize() {
+    size_t n = states();
+    size_t ntok = tokens.size();
+
+    // counting sort the other edges by token first, so each row is sorted
+    std::vector<uint32_t> cnt(ntok + 1, 0);
+    for (auto& j : jumps) {
+        if (j.tok != TOK_EPSILON) cnt[j.tok + 1]++;
+    }
+    std::partial_sum(cnt.begin(), cnt.end(), cnt.begin());
+    std::vector<Jump> sorted(cnt[ntok]);
+    for (auto& j : jumps) {
+        if (j.tok != TOK_EPSILON) sorted[cnt[j.tok]++] = j;
+    }
+
+    off.assign(n + 1, 0);
+    eps_off.assign(n + 1, 0);
+    for (auto& j : jumps) {
+        (j.tok == TOK_EPSILON ? eps_off : off)[j.from + 1]++;
+    }
+    std::partial_sum(off.begin(), off.end(), off.begin());
+    std::partial_sum(eps_off.begin(), eps_off.end(), eps_off.begin());
+
+    toks.resize(off[n]);
+    targets.resize(off[n]);
+    eps_targets.resize(eps_off[n]);
+    // reuse cnt as the fill position of each row
+    cnt.assign(eps_off.begin(), eps_off.end() - 1);
+    for (auto& j : jumps) {
+        if (j.tok == TOK_EPSILON) eps_targets[cnt[j.from]++] = j.to;
+    }
+    cnt.assign(off.begin(), off.end() - 1);
+    for (auto& j : sorted) {
+        uint32_t i = cnt[j.from]++;
+        toks[i] = j.tok;
+        targets[i] = j.to;
+    }
 
-Token NFA::get_token(const std::string& tok) {
-    auto it = tokenId.find(tok);
-    if (it == tokenId.end()) {
-        Token t = tokens.size();
-        tokenId[tok] = t;
-        tokens.push_back(tok);
-        return t;
+    jumps.clear();
+    jumps.shrink_to_fit();
+}
+
+void NFA::add_range(State a, uint8_t lo, uint8_t hi, State b) {
+    ranges.emplace_back(a, lo, hi, b);
+}
+
+void NFA::add_chars(State a, const CharRanges& chars, State b, bool wide) {
+    // largest code point taken as a single byte, the rest are utf-8 sequences
+    uint32_t single = (utf8 || wide) ? 0x7F : 0xFF;
+    for (auto [lo, hi] : chars) {
+        if (lo <= single) {
+            add_range(a, lo, std::min(hi, single), b);
+        }
+        if (hi <= single) continue;
+        std::vector<Utf8Seq> seqs;
+        utf8_ranges(std::max(lo, single + 1), hi, seqs);
+        for (auto& seq : seqs) {
+            State s = a;
+            for (size_t i = 0; i < seq.size(); i++) {
+                State t = i + 1 < seq.size() ? new_state() : b;
+                add_range(s, seq[i].first, seq[i].second, t);
+                s = t;
+            }
+        }
+    }
+}
+
+// chars of a class member, unicode chars beyond ascii go to wide without utf8 encoding
+void NFA::node_chars(ExprNode* node, CharRanges& chars, CharRanges& wide) {
+    uint32_t max = utf8 ? 0x10FFFF : 0xFF;
+    auto push = [&](uint32_t a, uint32_t b, bool w) {
+        (!utf8 && w && b > 0x7F ? wide : chars).emplace_back(a, b);
+    };
+    if (node->isType(ExprType::T_SEQUENCE)) {
+        for (auto x : static_cast<Sequence*>(node)->nodes) {
+            node_chars(x, chars, wide);
+        }
+    } else if (node->isType(ExprType::T_LITERAL)) {
+        const std::string& s = static_cast<Literal*>(node)->chars;
+        for (size_t i = 0; i < s.size();) {
+            size_t len = utf8_next(s.data() + i, s.size() - i);
+            uint32_t c = char_code(s.substr(i, len));
+            push(c, c, len > 1);
+            i += len;
+        }
+    } else if (node->isType(ExprType::T_RANGE)) {
+        auto range = static_cast<Range*>(node);
+        uint32_t a = char_code(range->start);
+        uint32_t b = char_code(range->end);
+        if (a > b) {
+            throw std::runtime_error("Range out of order: " + range->start + "-" + range->end);
+        }
+        push(a, b, is_wide(range->end));
+    } else if (node->isType(ExprType::T_ESCAPED)) {
+        auto& ch = static_cast<Escaped*>(node)->ch;
+        for (auto [a, b] : escaped_chars(ch, max)) {
+            push(a, b, is_wide(ch));
+        }
     } else {
-        return it->second;
+        throw std::runtime_error("DFA not support in class: " + node->typeName());
     }
-};
+}
+
+// split all byte ranges into disjoint classes, one token for each
+void NFA::build_classes() {
+    bool bound[257] = {false};
+    bool covered[256] = {false};
+    for (auto& [a, lo, hi, b] : ranges) {
+        bound[lo] = bound[hi + 1] = true;
+        std::fill(covered + lo, covered + hi + 1, true);
+    }
+
+    for (int c = 0; c < 256;) {
+        int e = c + 1;
+        while (e < 256 && !bound[e]) e++;
+        if (covered[c]) {
+            std::string name = byte_name(c);
+            if (e - 1 > c) name += "-" + byte_name(e - 1);
+            std::fill(byte_token + c, byte_token + e, tokens.size());
+            tokens.push_back(name);
+        }
+        c = e;
+    }
+
+    for (auto& [a, lo, hi, b] : ranges) {
+        for (int c = lo; c <= hi; c++) {
+            if (c == lo || byte_token[c] != byte_token[c - 1]) {
+                add_jump(a, byte_token[c], b);
+            }
+        }
+    }
+    ranges.clear();
+}
+
+// follow epsilon edges, and the anchor edges which only hold at the beginning or end of text
+void NFA::closure(Bits& b, Token anchor) const {
+    std::vector<State> stk;
+    b.each([&stk](State s) { stk.push_back(s); });
+    auto visit = [&](State next) {
+        if (b.test(next)) return;
+        b.set(next);
+        stk.push_back(next);
+    };
+    while (!stk.empty()) {
+        State s = stk.back(); stk.pop_back();
+        for (uint32_t i = eps_off[s]; i < eps_off[s+1]; i++) {
+            visit(eps_targets[i]);
+        }
+        if (anchor == TOK_EPSILON) continue;
+        // anchors sort before the byte classes
+        for (uint32_t i = off[s]; i < off[s+1] && toks[i] < TOK_CLASS; i++) {
+            if (toks[i] == anchor) visit(targets[i]);
+        }
+    }
+}
+
+// states reached from b on token t, closed
+Bits NFA::move(const Bits& b, Token t) const {
+    Bits res(states());
+    b.each([&](State s) {
+        for (uint32_t i = off[s]; i < off[s+1]; i++) {
+            if (toks[i] == t) res.set(targets[i]);
+        }
+    });
+    if (!res.empty()) closure(res);
+    return res;
+}
+
+uint32_t NFA::byte_classes(uint16_t classes[256]) const {
+    for (int c = 0; c < 256; c++) {
+        Token t = byte_token[c];
+        classes[c] = t == INVALID_TOKEN ? 0 : t - TOK_CLASS + 1;
+    }
+    return tokens.size() - TOK_CLASS + 1;
+}
+
+NFA NFA::reverse() const {
+    NFA r(color);
+    r.utf8 = utf8;
+    r.tokens = tokens;
+    std::copy(byte_token, byte_token + 256, r.byte_token);
+    // the start loop needs the bytes no edge accepts as well
+    for (int c = 0; c < 256; c++) {
+        if (byte_token[c] != INVALID_TOKEN) continue;
+        if (r.tokens.size() == tokens.size()) r.tokens.push_back(special_token("other"));
+        r.byte_token[c] = tokens.size();
+    }
+    r.saves.assign(states(), -1);
+
+    // swap the initial and final state, `^` and `$` swap as well
+    auto flip = [](State s) {
+        return s == state_initial ? state_final : s == state_final ? state_initial : s;
+    };
+    for (State s = 0; s < states(); s++) {
+        for (uint32_t i = eps_off[s]; i < eps_off[s+1]; i++) {
+            r.add_jump(flip(eps_targets[i]), TOK_EPSILON, flip(s));
+        }
+        for (uint32_t i = off[s]; i < off[s+1]; i++) {
+            Token t = toks[i] == TOK_BOL ? TOK_EOL : toks[i] == TOK_EOL ? TOK_BOL : toks[i];
+            r.add_jump(flip(targets[i]), t, flip(s));
+        }
+    }
+    for (Token t = TOK_CLASS; t < r.tokens.size(); t++) {
+        r.add_jump(state_initial, t, state_initial);
+    }
+    r.finalize();
+    return r;
+}
 
 void NFA::dump(std::ostream& os) {
     auto pack_color = [this](const std::string& s) {
@@ -54,7 +323,7 @@ void NFA::dump(std::ostream& os) {
     std::string border(20, '#');
     os << "\n" << border << " NFA Start " << border << "\n";
     size_t w = 10;
-    for (State s = 0; s < nfa.size(); s++) {
+    for (State s = 0; s < states(); s++) {
         std::string ss = std::to_string(s);
         ss = ("State " + ss + ":");
         if (s == state_initial) ss = ">" + ss;
@@ -62,25 +331,28 @@ void NFA::dump(std::ostream& os) {
         if (color && (s == state_initial || s == state_final)) {
             ss = pack_color(ss);
         }
-        os << visual_str_pad(ss, w, Align::RIGHT) << "\n";
-        for (auto it = nfa[s].begin(); it != nfa[s].end(); ++it) {
-            Token t = it->first;
-            std::string tok;
-            if (t == TOK_EPSILON) {
-                tok = pack_color(tokens[t]);
-            } else {
-                tok = tokens[t];
-            }
-            // int d = tokens[t].size() - visual_width(tokens[t]);
-            // os << std::setw(w+d-2) << std::right << (tokens[t] + ":") << " ";
+        os << visual_str_pad(ss, w, Align::RIGHT);
+        if (saves[s] >= 0) {
+            // capture slot: group * 2 (+1 at the end of group)
+            os << " {" << saves[s] << "}";
+        }
+        os << "\n";
+        auto print = [&](Token t, const uint32_t* nexts, size_t k) {
+            std::string tok = t == TOK_EPSILON ? pack_color(tokens[t]) : tokens[t];
             os << visual_str_pad(tok, w-1, Align::RIGHT) << ": ";
-            bool first = true;
-            for (State next : it->second) {
-                if (!first) os << ", ";
-                os << std::setw(2) << next;
-                first = false;
+            for (size_t i = 0; i < k; i++) {
+                if (i) os << ", ";
+                os << std::setw(2) << nexts[i];
             }
             os << "\n";
+        };
+        if (eps_off[s] < eps_off[s+1]) {
+            print(TOK_EPSILON, &eps_targets[eps_off[s]], eps_off[s+1] - eps_off[s]);
+        }
+        // targets of the same token are adjacent
+        for (uint32_t i = off[s], j; i < off[s+1]; i = j) {
+            for (j = i; j < off[s+1] && toks[j] == toks[i]; j++);
+            print(toks[i], &targets[i], j - i);
         }
         os << "\n";
     }
@@ -89,13 +361,90 @@ void NFA::dump(std::ostream& os) {
 
 void NFA::generate(ExprNode* expr, bool utf8_encoding) {
     assert(expr);
+    utf8 = utf8_encoding;
+    build(expr, state_initial, state_final);
+    build_classes();
+    finalize();
+    literals = extract_literals(expr);
+    max_len = longest_path();
+}
 
-    State start = 0;
-    State end = 1;
+// bytes on the longest path from the start, NO_MATCH if a cycle is reachable
+size_t NFA::longest_path() const {
+    std::vector<uint8_t> mark(states(), 0);    // 1 on the stack, 2 done
+    std::vector<size_t> len(states(), 0);
+    auto edges = [this](State s) {
+        return eps_off[s+1] - eps_off[s] + off[s+1] - off[s];
+    };
+    // edge k of s, epsilons first, and its length in bytes
+    auto edge = [this](State s, uint32_t k) -> std::pair<State,size_t> {
+        uint32_t neps = eps_off[s+1] - eps_off[s];
+        if (k < neps) return {eps_targets[eps_off[s] + k], 0};
+        uint32_t i = off[s] + k - neps;
+        return {targets[i], toks[i] == TOK_BOL || toks[i] == TOK_EOL ? 0 : 1};
+    };
+
+    std::vector<std::pair<State,uint32_t>> stk = {{state_initial, 0}};
+    mark[state_initial] = 1;
+    while (!stk.empty()) {
+        auto [s, k] = stk.back();
+        if (k < edges(s)) {
+            stk.back().second++;
+            State t = edge(s, k).first;
+            if (mark[t] == 1) return NO_MATCH;
+            if (mark[t] == 0) {
+                mark[t] = 1;
+                stk.push_back({t, 0});
+            }
+            continue;
+        }
+        for (k = 0; k < edges(s); k++) {
+            auto [t, w] = edge(s, k);
+            len[s] = std::max(len[s], len[t] + w);
+        }
+        mark[s] = 2;
+        stk.pop_back();
+    }
+    return len[state_initial];
+}
+
+void NFA::generate(const std::vector<ExprNode*>& exprs, bool utf8_encoding, bool anchored) {
+    utf8 = utf8_encoding;
+    finals.clear();
+    for (ExprNode* expr : exprs) {
+        assert(expr);
+        State start = new_state();
+        State end = new_state();
+        add_jump(state_initial, TOK_EPSILON, start);
+        build(expr, start, end);
+        add_jump(end, TOK_EPSILON, state_final);
+        finals.push_back(end);
+    }
+    build_classes();
+    if (!anchored) {
+        // any byte may come before a match
+        Token other = INVALID_TOKEN;
+        for (int c = 0; c < 256; c++) {
+            if (byte_token[c] != INVALID_TOKEN) continue;
+            if (other == INVALID_TOKEN) {
+                other = tokens.size();
+                tokens.push_back(special_token("other"));
+            }
+            byte_token[c] = other;
+        }
+        for (Token t = TOK_CLASS; t < tokens.size(); t++) {
+            add_jump(state_initial, t, state_initial);
+        }
+    }
+    finalize();
+}
+
+// edges from start to end accepting expr
+void NFA::build(ExprNode* expr, State start, State end) {
+    uint32_t max = utf8 ? 0x10FFFF : 0xFF;
 
     enum class Flag {
         Default,
-        InClass,
         Skip
     };
 
@@ -106,6 +455,15 @@ void NFA::generate(ExprNode* expr, bool utf8_encoding) {
         return std::make_pair(std::make_pair(a, b), flag);
     };
 
+    // the whole subtree of node is already handled
+    auto skip = [&](ExprNode* node) {
+        size_t k = 0;
+        node->travel([&k](ExprNode*) { k++; });
+        while (k--) {
+            stk.push(make_item(0, 0, Flag::Skip));
+        }
+    };
+
     stk.push(make_item(start, end));
 
     std::function<void(ExprNode*)> fn = [&](ExprNode* node) {
@@ -121,135 +479,129 @@ void NFA::generate(ExprNode* expr, bool utf8_encoding) {
         if (node == nullptr) {
             add_jump(begin, TOK_EPSILON, next);
         } else if (node->isType(ExprType::T_OR)) {
+            // each branch from its own state, tried in order
             auto branch = static_cast<Or*>(node);
-            size_t i = branch->items.size();
+            std::vector<State> starts;
+            for (size_t i = 0; i < branch->items.size(); i++) {
+                starts.push_back(new_state());
+                add_jump(begin, TOK_EPSILON, starts.back());
+            }
+            size_t i = starts.size();
             while (i--) {
-                stk.push(make_item(begin, next));
+                stk.push(make_item(starts[i], next));
             }
         } else if (node->isType(ExprType::T_SEQUENCE)) {
             auto seq = static_cast<Sequence*>(node);
             size_t k = seq->nodes.size();
-            if (flag == Flag::InClass) { // Or mode in Class
-                while (k--) {
-                    stk.push(make_item(begin, next, flag));
-                }
-            } else {
-                State s = next;
-                for (size_t i=0; i<k-1; i++) {
-                    State t = new_state();
-                    stk.push(make_item(t, s));
-                    s = t;
-                }
-                stk.push(make_item(begin, s));
+            State s = next;
+            for (size_t i=0; i<k-1; i++) {
+                State t = new_state();
+                stk.push(make_item(t, s));
+                s = t;
             }
+            stk.push(make_item(begin, s));
         } else if (node->isType(ExprType::T_QUANTIFIER)) {
             auto q = static_cast<Quantifier*>(node);
-            State s;
             if (q->max == 0) {
                 add_jump(begin, TOK_EPSILON, next);
-                stk.push(make_item(begin, next, Flag::Skip));
+                skip(q->prev);
                 return;
             }
-            if (q->min == q->max) {
-                int m = q->min - 1;
-                while (m-- > 0) {
-                    s = new_state();
-                    stk.push(make_item(begin, s));
-                    q->prev->travel(fn);
-                    begin = s;
-                }
-                stk.push(make_item(begin, next));
+            bool lazy = q->tag == QuantifierTag::LAZY;
+            // choice between another body and leaving, the preferred one first
+            auto choice = [&](State s, State body) {
+                add_jump(s, TOK_EPSILON, lazy ? next : body);
+                add_jump(s, TOK_EPSILON, lazy ? body : next);
+            };
+
+            // [from, to] of each copy of the body
+            std::vector<std::pair<State,State>> bodies;
+            State cur = begin;
+            for (int m = 0; m < q->min; m++) {
+                State s = (m + 1 == q->min && q->min == q->max) ? next : new_state();
+                bodies.emplace_back(cur, s);
+                cur = s;
+            }
+            if (q->max == INF) {
+                State loop = new_state();
+                State body = new_state();
+                add_jump(cur, TOK_EPSILON, loop);
+                choice(loop, body);
+                bodies.emplace_back(body, loop);
             } else {
-                int m = q->min;
-                while (m-- > 0) {
-                    s = new_state();
-                    stk.push(make_item(begin, s));
-                    q->prev->travel(fn);
-                    begin = s;
-                }
-                add_jump(begin, TOK_EPSILON, next);
-                if (q->max == INF) {
-                    stk.push(make_item(next, next));
-                } else {
-                    for (m = q->min + 1; m < q->max; m++) {
-                        s = new_state();
-                        add_jump(s, TOK_EPSILON, next);
-                        stk.push(make_item(begin, s));
-                        q->prev->travel(fn);
-                        begin = s;
-                    }
-                    stk.push(make_item(begin, next));
+                for (int m = q->min; m < q->max; m++) {
+                    State body = new_state();
+                    State s = m + 1 == q->max ? next : new_state();
+                    choice(cur, body);
+                    bodies.emplace_back(body, s);
+                    cur = s;
                 }
             }
+
+            // the last copy is built by the outer travel
+            for (size_t i = 0; i + 1 < bodies.size(); i++) {
+                stk.push(make_item(bodies[i].first, bodies[i].second));
+                q->prev->travel(std::ref(fn));
+            }
+            stk.push(make_item(bodies.back().first, bodies.back().second));
         } else if (node->isType(ExprType::T_CLASS)) {
             auto cls = static_cast<Class*>(node);
+            CharRanges chars, wide;
+            node_chars(cls->seq, chars, wide);
             if (cls->negative) {
-                throw std::runtime_error("DFA not support negative class!");
+                // the complement of multibyte chars is only defined over code points
+                if (!wide.empty()) {
+                    throw std::runtime_error("DFA not support for: negated class with non-ASCII chars without utf8 encoding");
+                }
+                chars = negate(chars, max);
             }
-            stk.push(make_item(begin, next, Flag::InClass));
+            add_chars(begin, chars, next);
+            add_chars(begin, wide, next, true);
+            skip(cls->seq);
         } else if (node->isType(ExprType::T_RANGE)) {
-            auto range = static_cast<Range*>(node);
-            if (range->start.size() == 1 && range->end.size() == 1) {
-                char a = range->start[0];
-                char b = range->end[0];
-                if (b - a < 30) {
-                    for (char c=a; c<=b; c++) {
-                        Token t = get_token({c});
-                        add_jump(begin, t, next);
-                    }
-                } else {
-                    // keep it if range too large
-                    Token t = get_token(range->start + "-" + range->end);
-                    add_jump(begin, t, next);
+            CharRanges chars, wide;
+            node_chars(node, chars, wide);
+            add_chars(begin, chars, next);
+            add_chars(begin, wide, next, true);
+        } else if (node->isType(ExprType::T_GROUP)) {
+            auto group = static_cast<Group*>(node);
+            if (group->capture && group->id > 0) {
+                // record the span between an open and a close state
+                if (group_names.size() <= (size_t)group->id) {
+                    group_names.resize(group->id + 1);
                 }
+                group_names[group->id] = group->name;
+                State open = new_state(2 * group->id);
+                State close = new_state(2 * group->id + 1);
+                add_jump(begin, TOK_EPSILON, open);
+                add_jump(close, TOK_EPSILON, next);
+                stk.push(make_item(open, close));
             } else {
-                Token t = get_token(range->start + "-" + range->end);
-                add_jump(begin, t, next);
+                stk.push(make_item(begin, next));
             }
-        } else if (node->isType(ExprType::T_GROUP)) {
-            // auto group = static_cast<Group*>(node);
-            stk.push(make_item(begin, next));
         } else if (node->isType(ExprType::T_LITERAL)) {
-            auto literal = static_cast<Literal*>(node);
-            for (size_t i=0; i<literal->escaped.size();) {
-                int len = (literal->escaped[i] == '\\') ? 2 : 1;
-                std::string tok = literal->escaped.substr(i, len);
-                Token t = get_token(tok);
-                i += len;
-                if (flag == Flag::InClass) {
-                    add_jump(begin, t, next);
-                } else {
-                    State s = i < literal->escaped.size()? new_state() : next;
-                    add_jump(begin, t, s);
-                    begin = s;
-                }
+            // raw bytes, utf-8 text stays as it is
+            const std::string& chars = static_cast<Literal*>(node)->chars;
+            for (size_t i=0; i<chars.size(); i++) {
+                State s = i + 1 < chars.size() ? new_state() : next;
+                uint8_t c = chars[i];
+                add_range(begin, c, c, s);
+                begin = s;
             }
         } else if (node->isType(ExprType::T_ANCHOR)) {
             auto anchor = static_cast<Anchor*>(node);
-            Token t = get_token(special_token(anchor->val));
-            add_jump(begin, t, next);
+            if (anchor->val == "^") {
+                add_jump(begin, TOK_BOL, next);
+            } else if (anchor->val == "$") {
+                add_jump(begin, TOK_EOL, next);
+            } else {
+                throw std::runtime_error("DFA not support for: " + anchor->val);
+            }
         } else if (node->isType(ExprType::T_ANY)) {
-            Token t = get_token(special_token("."));
-            add_jump(begin, t, next);
+            add_chars(begin, negate({{'\n', '\n'}}, max), next);
         } else if (node->isType(ExprType::T_ESCAPED)) {
             auto escaped = static_cast<Escaped*>(node);
-            Token t;
-            if (escaped->isUnicode()) {
-                if (utf8_encoding) {
-                    t = get_token(uhhhh_to_utf8(escaped->ch));
-                } else {
-                    auto tmp = "U+" + escaped->ch.substr(2);
-                    std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::toupper);
-                    t = get_token(tmp);
-                }
-            } else if (escaped->isHex()) {
-                auto tmp = "0x" + escaped->ch.substr(2);
-                std::transform(tmp.begin()+2, tmp.end(), tmp.begin()+2, ::toupper);
-                t = get_token(tmp);
-            } else {
-                t = get_token(special_token(escaped->ch));
-            }
-            add_jump(begin, t, next);
+            add_chars(begin, escaped_chars(escaped->ch, max), next, is_wide(escaped->ch));
         } else {
             // not supported
             std::string err = "DFA not support for: " + node->typeName();
@@ -259,21 +611,256 @@ void NFA::generate(ExprNode* expr, bool utf8_encoding) {
 
     };
 
-    expr->travel(fn);
+    expr->travel(std::ref(fn));
+}
+
+// bounds of the literal analysis, larger sets are unknown
+#define MAX_LITERALS 16     // products of sets, and bytes of a class
+#define MAX_WORDS    4096   // alternations, and sets joined with a single string
+#define MAX_REPEAT   8
+
+// literals of a subtree: all the strings it matches while there are few of them,
+// else the ones its matches start or end with
+struct LiteralInfo {
+    bool exact = false;                 // strs are all the matched strings
+    std::vector<std::string> strs;
+    std::vector<std::string> prefixes;  // empty if unknown
+    std::vector<std::string> suffixes;
+    std::string inner;                  // in every match, the longer the rarer
+};
+
+static void sort_unique(std::vector<std::string>& v) {
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+}
+
+// a + b of each pair into res, false if there are too many
+static bool cross(const std::vector<std::string>& a, const std::vector<std::string>& b,
+    std::vector<std::string>& res) {
+    size_t limit = a.size() == 1 || b.size() == 1 ? MAX_WORDS : MAX_LITERALS;
+    if (a.size() * b.size() > limit) return false;
+    std::vector<std::string> r;
+    for (auto& x : a) {
+        for (auto& y : b) r.push_back(x + y);
+    }
+    sort_unique(r);
+    res = std::move(r);
+    return true;
+}
+
+// a prefix or suffix set is unknown if a match may be empty
+static std::vector<std::string> known(const std::vector<std::string>& v) {
+    for (auto& s : v) {
+        if (s.empty()) return {};
+    }
+    return v;
+}
+
+static void prefer(std::string& best, const std::string& s) {
+    if (s.size() > best.size()) best = s;
 }
 
-void NFA::simplify()
-{
-    return;
-    std::vector<int> eps_next(nfa.size(), -1);
-    for (State s = 0; s < nfa.size(); s++) {
-        auto& mp = nfa[s];
-        if (mp.size() == 1 && mp.find(TOK_EPSILON) != mp.end()) {
-            eps_next[s] = *mp[TOK_EPSILON].begin();
+// what all of v start with, or end with
+static std::string common(const std::vector<std::string>& v, bool end) {
+    if (v.empty()) return "";
+    size_t k = v[0].size();
+    for (auto& s : v) {
+        k = std::min(k, s.size());
+        size_t i = 0;
+        if (end) {
+            while (i < k && s[s.size()-1-i] == v[0][v[0].size()-1-i]) i++;
+        } else {
+            while (i < k && s[i] == v[0][i]) i++;
         }
+        k = i;
     }
+    return end ? v[0].substr(v[0].size() - k) : v[0].substr(0, k);
 }
 
+Literals NFA::extract_literals(ExprNode* expr) {
+    // single bytes of chars, false if there are too many or some are utf-8 sequences
+    auto bytes = [](const CharRanges& chars, uint32_t single, std::vector<std::string>& res) {
+        size_t k = 0;
+        for (auto [a, b] : chars) {
+            if (b > single) return false;
+            k += b - a + 1;
+        }
+        if (k > MAX_LITERALS) return false;
+        for (auto [a, b] : chars) {
+            for (uint32_t c = a; c <= b; c++) res.push_back(std::string(1, (char)c));
+        }
+        return true;
+    };
+
+    std::function<LiteralInfo(ExprNode*)> info = [&](ExprNode* node) {
+        LiteralInfo r;
+        if (node == nullptr || node->isType(ExprType::T_ANCHOR)) {
+            r.exact = true;
+            r.strs = {""};
+        } else if (node->isType(ExprType::T_ROOT)) {
+            return info(static_cast<ExprRoot*>(node)->expr);
+        } else if (node->isType(ExprType::T_GROUP)) {
+            return info(static_cast<Group*>(node)->expr);
+        } else if (node->isType(ExprType::T_LITERAL)) {
+            r.exact = true;
+            r.strs = {static_cast<Literal*>(node)->chars};
+        } else if (node->isType(ExprType::T_ESCAPED)) {
+            auto& ch = static_cast<Escaped*>(node)->ch;
+            uint32_t single = utf8 || is_wide(ch) ? 0x7F : 0xFF;
+            r.exact = bytes(escaped_chars(ch, single), single, r.strs);
+        } else if (node->isType(ExprType::T_CLASS) || node->isType(ExprType::T_RANGE)) {
+            ExprNode* members = node;
+            if (node->isType(ExprType::T_CLASS)) {
+                auto cls = static_cast<Class*>(node);
+                members = cls->negative ? nullptr : cls->seq;
+            }
+            CharRanges chars, wide;
+            if (members) node_chars(members, chars, wide);
+            r.exact = members && wide.empty() && bytes(chars, utf8 ? 0x7F : 0xFF, r.strs);
+        } else if (node->isType(ExprType::T_OR)) {
+            std::vector<LiteralInfo> items;
+            r.exact = true;
+            for (auto x : static_cast<Or*>(node)->items) {
+                items.push_back(info(x));
+                r.exact = r.exact && items.back().exact;
+                r.strs.insert(r.strs.end(), items.back().strs.begin(), items.back().strs.end());
+            }
+            sort_unique(r.strs);
+            r.exact = r.exact && r.strs.size() <= MAX_WORDS;
+            if (!r.exact) {
+                r.inner = items[0].inner;
+                for (auto& x : items) {
+                    if (x.inner != r.inner) r.inner.clear();
+                    r.prefixes.insert(r.prefixes.end(), x.prefixes.begin(), x.prefixes.end());
+                    r.suffixes.insert(r.suffixes.end(), x.suffixes.begin(), x.suffixes.end());
+                }
+                // one unknown branch makes the set unknown
+                auto all = [&](auto field) {
+                    for (auto& x : items) {
+                        if ((x.*field).empty()) return false;
+                    }
+                    return true;
+                };
+                if (!all(&LiteralInfo::prefixes)) r.prefixes.clear();
+                if (!all(&LiteralInfo::suffixes)) r.suffixes.clear();
+                sort_unique(r.prefixes);
+                sort_unique(r.suffixes);
+                if (r.prefixes.size() > MAX_WORDS) r.prefixes.clear();
+                if (r.suffixes.size() > MAX_WORDS) r.suffixes.clear();
+            }
+        } else if (node->isType(ExprType::T_SEQUENCE)) {
+            std::vector<LiteralInfo> items;
+            for (auto x : static_cast<Sequence*>(node)->nodes) {
+                items.push_back(info(x));
+            }
+            r.exact = true;
+            r.strs = {""};
+            for (auto& x : items) {
+                if (!x.exact || !cross(r.strs, x.strs, r.strs)) {
+                    r.exact = false;
+                    break;
+                }
+            }
+            if (!r.exact) {
+                // exact items from either end, then the prefixes or suffixes of the next one
+                std::vector<std::string> pre = {""}, suf = {""};
+                for (auto& x : items) {
+                    if (x.exact && cross(pre, x.strs, pre)) continue;
+                    if (!x.exact && !x.prefixes.empty()) cross(pre, x.prefixes, pre);
+                    break;
+                }
+                for (size_t i = items.size(); i--;) {
+                    auto& x = items[i];
+                    if (x.exact && cross(x.strs, suf, suf)) continue;
+                    if (!x.exact && !x.suffixes.empty()) cross(x.suffixes, suf, suf);
+                    break;
+                }
+                r.prefixes = known(pre);
+                r.suffixes = known(suf);
+
+                // runs of single strings, joined with what the items around them start or end with
+                std::string run;
+                for (auto& x : items) {
+                    if (x.exact && x.strs.size() == 1) {
+                        run += x.strs[0];
+                        continue;
+                    }
+                    prefer(r.inner, run + (x.prefixes.size() == 1 ? x.prefixes[0] : ""));
+                    prefer(r.inner, x.inner);
+                    run = x.suffixes.size() == 1 ? x.suffixes[0] : "";
+                }
+                prefer(r.inner, run);
+            }
+        } else if (node->isType(ExprType::T_QUANTIFIER)) {
+            auto q = static_cast<Quantifier*>(node);
+            LiteralInfo x = q->max > 0 ? info(q->prev) : LiteralInfo();
+            if (q->max == 0) {
+                r.exact = true;
+                r.strs = {""};
+            } else if (x.exact && q->max <= MAX_REPEAT) {
+                // the body repeated min to max times
+                std::vector<std::string> rep = {""};
+                r.exact = true;
+                for (int k = 0; k <= q->max && r.exact; k++) {
+                    if (k >= q->min) r.strs.insert(r.strs.end(), rep.begin(), rep.end());
+                    if (k < q->max && !cross(rep, x.strs, rep)) r.exact = false;
+                }
+                sort_unique(r.strs);
+                r.exact = r.exact && r.strs.size() <= MAX_WORDS;
+            }
+            if (!r.exact && q->min > 0) {
+                r.prefixes = x.prefixes;
+                r.suffixes = x.suffixes;
+                r.inner = x.inner;
+            }
+        }
+        // Any, lookarounds and back references are unknown
+
+        if (r.exact) {
+            sort_unique(r.strs);
+            r.prefixes = r.suffixes = known(r.strs);
+        } else {
+            r.strs.clear();
+        }
+        prefer(r.inner, common(r.prefixes, false));
+        prefer(r.inner, common(r.suffixes, true));
+        return r;
+    };
+
+    LiteralInfo x = info(expr);
+    Literals res;
+    res.prefixes = std::move(x.prefixes);
+    res.suffixes = std::move(x.suffixes);
+    res.inner = std::move(x.inner);
+
+    // an alternation of plain literals needs no automaton
+    std::function<bool(ExprNode*, std::string&)> plain = [&](ExprNode* node, std::string& s) {
+        if (!node) return false;
+        if (node->isLiteral()) {
+            s += static_cast<Literal*>(node)->chars;
+            return true;
+        }
+        if (node->isGroup()) return plain(static_cast<Group*>(node)->expr, s);
+        if (!node->isSequence()) return false;
+        for (auto x : static_cast<Sequence*>(node)->nodes) {
+            if (!plain(x, s)) return false;
+        }
+        return true;
+    };
+    ExprNode* node = expr->isRoot() ? static_cast<ExprRoot*>(expr)->expr : expr;
+    while (node && node->isGroup()) node = static_cast<Group*>(node)->expr;
+    if (node && node->isOR()) {
+        for (auto item : static_cast<Or*>(node)->items) {
+            std::string s;
+            if (!plain(item, s) || s.empty()) {
+                res.words.clear();
+                break;
+            }
+            res.words.push_back(s);
+        }
+    }
+    return res;
+}
 
 void DFA::add_jump(State a, Token t, State b) {
     while (dfa.size() <= std::max(a, b)) dfa.push_back({});
@@ -291,9 +878,8 @@ void DFA::dump(std::ostream& os) {
 
     const std::vector<std::string>& tokens = nfa->tokens;
     size_t max_tok_len = std::to_string(dfa.size()).size();
-    for (const std::string& t : tokens) {
-        if (t == EPSILON) continue;
-        max_tok_len = std::max(max_tok_len, visual_width(t));
+    for (Token t = TOK_CLASS; t < tokens.size(); t++) {
+        max_tok_len = std::max(max_tok_len, visual_width(tokens[t]));
     }
     size_t width = max_tok_len + 1;
 
@@ -303,9 +889,8 @@ void DFA::dump(std::ostream& os) {
 
     size_t header_len = 13;
     os << std::setw(header_len) << std::right << "Tokens:";
-    for (const std::string& t : tokens) {
-        if (t == EPSILON) continue;
-        auto tk = pack_color(t);
+    for (Token t = TOK_CLASS; t < tokens.size(); t++) {
+        auto tk = pack_color(tokens[t]);
         os << visual_str_pad(tk, width, Align::RIGHT);
     }
     os << "\n";
@@ -318,7 +903,7 @@ void DFA::dump(std::ostream& os) {
             ss = ">" + ss;
             c = true;
         }
-        if (terminals.find(s) != terminals.end()) {
+        if (is_accepted(s)) {
             ss = "*" + ss;
             c = true;
         }
@@ -326,8 +911,7 @@ void DFA::dump(std::ostream& os) {
         os << visual_str_pad(ss, header_len, Align::RIGHT);
 
         auto& mp = dfa[s];
-        for (Token tok = 0; tok < tokens.size(); tok++) {
-            if (tok == TOK_EPSILON) continue;
+        for (Token tok = TOK_CLASS; tok < tokens.size(); tok++) {
             auto it = mp.find(tok);
             if (it != mp.end()) {
                 os << std::setw(width) << std::right << it->second;
@@ -340,10 +924,11 @@ void DFA::dump(std::ostream& os) {
 
     os << "Accept States: ";
     bool first = true;
-    for (State s : terminals) {
-        if (!is_valid(s)) continue;
+    for (State s = 0; s < dfa.size(); s++) {
+        if (!is_valid(s) || !is_accepted(s)) continue;
         if (!first) os << ", ";
-        os << s;
+        // accepted only at the end of text
+        os << s << (terminals.count(s) ? "" : special_token("$"));
         first = false;
     }
     os << "\n";
@@ -357,82 +942,106 @@ bool DFA::is_color() {
 
 
 void DFA::nfa_to_dfa() {
-    std::vector<std::unordered_set<State>> epsClosure;
-
-    std::function<void(State,State)> epsilon_closure = [&epsilon_closure,this,&epsClosure](State x, State s) {
-        std::unordered_set<State>& closure = epsClosure[x];
-        if (closure.find(s) != closure.end()) return;
-        closure.insert(s);
-        if (s < x) {
-            for (State next : epsClosure[s]) {
-                closure.insert(next);
-            }
-            return;
-        }
-        auto it = nfa->nfa[s].find(TOK_EPSILON);
-        if (it != nfa->nfa[s].end()) {
-            for (State next : it->second) {
-                epsilon_closure(x, next);
-            }
-        }
-    };
+    size_t states = nfa->states();
 
-    auto find_closure = [this,&epsClosure](const Bits& b, Token t) {
-        Bits res(b.size(), 0);
-        for (State s=0; s<b.size(); s++) {
-            if (!b[s]) continue;
-            auto it = nfa->nfa[s].find(t);
-            if (it == nfa->nfa[s].end()) continue;
-            for (State next : it->second) {
-                res[next] = true;
-                for (State x : epsClosure[next]) {
-                    res[x] = true;
-                }
-            }
-        }
-        return res;
+    auto closure = [this](Bits& b, Token anchor) {
+        nfa->closure(b, anchor);
     };
 
-    size_t states = nfa->nfa.size();
-    for (State s = 0; s < states; s++) {
-        epsClosure.push_back({});
-        epsilon_closure(s, s);
-    }
-
-    std::vector<Bits> nfa_closure; // [dfa state: {nfa states closure...}, ...]
-    
-    nfa_closure.emplace_back(states, false);
-
-    // initial state
-    for (auto s : epsClosure[0]) {
-        nfa_closure[0][s] = true;
+    // pattern of each accept state of a set
+    std::vector<int> pattern(states, -1);
+    for (size_t i = 0; i < nfa->finals.size(); i++) {
+        pattern[nfa->finals[i]] = i;
     }
+    std::unordered_map<Bits,uint32_t,Bits::Hash> set_id;
+    pattern_sets.clear();
+    tags.clear();
+    auto intern = [&](const Bits& r) {
+        Bits b(nfa->finals.size());
+        r.each([&](State x) {
+            if (pattern[x] >= 0) b.set(pattern[x]);
+        });
+        auto [it, ok] = set_id.emplace(b, pattern_sets.size());
+        if (ok) pattern_sets.push_back(std::move(b));
+        return it->second;
+    };
+    if (!nfa->finals.empty()) intern(Bits(states));
 
-    auto findClosureId = [](const std::vector<Bits>& closures, const Bits& bs) {
-        for (State s = 0; s < closures.size(); s++) {
-            if (bs == closures[s]) {
-                return s;
-            }
+    auto mark = [&](State s, const Bits& r) {
+        if (r.test(nfa->state_final)) {
+            terminals.insert(s);
+        }
+        Bits e = r;
+        closure(e, TOK_EOL);
+        if (e.test(nfa->state_final)) {
+            eot_terminals.insert(s);
+        }
+        if (!nfa->finals.empty()) {
+            tags.emplace_back(intern(r), intern(e));
         }
-        return closures.size();
     };
 
-    State s = 0;
-    while (s < nfa_closure.size()) {
-        for (Token tok = TOK_EPSILON+1; tok < nfa->tokens.size(); tok++) {
-            Bits r = find_closure(nfa_closure[s], tok);
-            State next = findClosureId(nfa_closure, r);
-            if (next == nfa_closure.size()) {
-                nfa_closure.push_back(r);
+    std::vector<Bits> nfa_closure; // [dfa state: {nfa states closure...}, ...]
+    std::unordered_map<Bits,State,Bits::Hash> closure_id;
+
+    auto find_state = [&](Bits&& b) {
+        auto it = closure_id.find(b);
+        if (it != closure_id.end()) return it->second;
+        State id = nfa_closure.size();
+        closure_id.emplace(b, id);
+        nfa_closure.push_back(std::move(b));
+        mark(id, nfa_closure.back());
+        return id;
+    };
+
+    // initial states, at the beginning of text and inside the text
+    Bits inner(states);
+    inner.set(nfa->state_initial);
+    closure(inner, TOK_EPSILON);
+    const Bits inner_closure = inner;
+    Bits bot = inner;
+    closure(bot, TOK_BOL);
+    state_initial = find_state(std::move(bot));
+    state_inner = find_state(std::move(inner));
+
+    // moves of a dfa state on each token, filled edge by edge
+    size_t ntok = nfa->tokens.size();
+    std::vector<Bits> moves(ntok, Bits(states));
+    std::vector<bool> touched(ntok);
+    State dead = INVALID_STATE;
+    for (State s = 0; s < nfa_closure.size(); s++) {
+        nfa_closure[s].each([&](State x) {
+            for (uint32_t i = nfa->off[x]; i < nfa->off[x+1]; i++) {
+                Token tok = nfa->toks[i];
+                if (tok < TOK_CLASS) continue;
+                moves[tok].set(nfa->targets[i]);
+                touched[tok] = true;
+            }
+        });
+        for (Token tok = TOK_CLASS; tok < ntok; tok++) {
+            // empty moves lead to the dead state, dropped in simplify
+            if (!touched[tok]) {
+                if (dead == INVALID_STATE) dead = find_state(Bits(states));
+                add_jump(s, tok, dead);
+                continue;
             }
-            add_jump(s, tok, next);
-            if (r[nfa->state_final]) {
-                terminals.insert(next);
+            Bits r = std::move(moves[tok]);
+            moves[tok] = Bits(states);
+            touched[tok] = false;
+            if (r.test(nfa->state_initial)) {
+                // the start loop of a set reaches the initial state on most moves
+                r.reset(nfa->state_initial);
+                closure(r, TOK_EPSILON);
+                r |= inner_closure;
+            } else {
+                closure(r, TOK_EPSILON);
             }
+            add_jump(s, tok, find_state(std::move(r)));
         }
-        s++;
     }
+    dfa.resize(std::max(dfa.size(), nfa_closure.size()));
 
+    LOG_DEBUG("DFA subset construction: %zu states\n", nfa_closure.size());
 }
 
 bool DFA::is_valid(State s) {
@@ -440,7 +1049,11 @@ bool DFA::is_valid(State s) {
 }
 
 bool DFA::is_accepted(State s) {
-    return terminals.find(s) != terminals.end();
+    return terminals.find(s) != terminals.end() || is_accepted_eot(s);
+}
+
+bool DFA::is_accepted_eot(State s) {
+    return eot_terminals.find(s) != eot_terminals.end();
 }
 
 State DFA::next(State s, Token t) {
@@ -469,117 +1082,394 @@ const std::vector<std::string> DFA::get_tokens() {
     return nfa->tokens;
 }
 
-void DFA::simplify() {
-    std::vector<bool> visited(dfa.size(), false);
+void DFA::freeze() {
+    table = DFATable();
 
-    std::function<void(State)> dfs = [&dfs,&visited,this](State s) {
-        if (visited[s]) return;
-        visited[s] = true;
-        if (is_accepted(s)) {
-            valids.insert(s);
-        }
-        for (auto [tok, next] : dfa[s]) {
-            dfs(next);
-            if (valids.count(next)) {
-                valids.insert(s);
-            }
-        }
+    // frozen ids: dead state first, then the valid states in order
+    std::vector<uint32_t> ids(dfa.size(), DEAD_STATE);
+    uint32_t n = 1;
+    for (State s = 0; s < dfa.size(); s++) {
+        if (is_valid(s)) ids[s] = n++;
+    }
+    auto frozen = [&ids, this](State s) {
+        return is_valid(s) ? ids[s] : DEAD_STATE;
     };
 
-    // 查找无效节点
-    dfs(state_initial);
+    // class 0 holds the bytes no edge accepts
+    table.alphabet = nfa->byte_classes(table.classes);
 
-    std::vector<State> a, b;
+    table.trans.assign(n * table.alphabet, DEAD_STATE);
+    table.flags.assign(n, 0);
     for (State s = 0; s < dfa.size(); s++) {
         if (!is_valid(s)) continue;
-        if (is_accepted(s)) {
-            a.push_back(s);
-        } else {
-            b.push_back(s);
+        uint32_t* row = &table.trans[ids[s] * table.alphabet];
+        for (auto [tok, next] : dfa[s]) {
+            if (tok >= TOK_CLASS) row[tok - TOK_CLASS + 1] = frozen(next);
+        }
+        uint8_t& f = table.flags[ids[s]];
+        if (terminals.count(s)) f |= DFATable::ACCEPT;
+        if (is_accepted_eot(s)) f |= DFATable::ACCEPT_EOT;
+    }
+
+    table.initial_bot = frozen(state_initial);
+    table.initial = frozen(state_inner);
+
+    if (!tags.empty()) {
+        table.tags.assign(n, 0);
+        table.eot_tags.assign(n, 0);
+        for (State s = 0; s < dfa.size(); s++) {
+            if (!is_valid(s)) continue;
+            table.tags[ids[s]] = tags[s].first;
+            table.eot_tags[ids[s]] = tags[s].second;
+        }
+        table.set_off.push_back(0);
+        for (const Bits& b : pattern_sets) {
+            b.each([this](size_t p) { table.set_ids.push_back(p); });
+            table.set_off.push_back(table.set_ids.size());
         }
     }
-    std::unordered_map<State,size_t> setid;
-    setid[INVALID_STATE] = INVALID_STATE;
-    for (State s : a) {
-        setid[s] = a[0];
+
+    LOG_DEBUG("DFA table: %zu states x %u classes\n", table.states(), table.alphabet);
+}
+
+const DFATable& DFA::get_table() {
+    return table;
+}
+
+const DFATable& DFA::get_reversed_table() {
+    if (!rdfa) {
+        rnfa = std::make_unique<NFA>(nfa->reverse());
+        rdfa = std::make_unique<DFA>(rnfa.get());
+        rdfa->generate();
+    }
+    return rdfa->table;
+}
+
+// end of the longest match starting at pos, NO_MATCH if none
+size_t DFA::longest(std::string_view text, size_t pos) {
+    const uint32_t* trans = table.trans.data();
+    const uint8_t* flags = table.flags.data();
+    const uint16_t* classes = table.classes;
+    const uint32_t k = table.alphabet;
+    const size_t n = text.size();
+
+    uint32_t s = pos == 0 ? table.initial_bot : table.initial;
+    if (s == DEAD_STATE) return NO_MATCH;
+
+    size_t end = NO_MATCH;
+    if ((flags[s] & DFATable::ACCEPT) || (pos == n && (flags[s] & DFATable::ACCEPT_EOT))) {
+        end = pos;
     }
-    for (State s : b) {
-        setid[s] = b[0];
+    for (size_t i = pos; i < n; i++) {
+        s = trans[s * k + classes[(unsigned char)text[i]]];
+        if (s == DEAD_STATE) return end;
+        if (flags[s] & DFATable::ACCEPT) end = i+1;
     }
-    std::queue<std::vector<State>> equiv_sets;
-    equiv_sets.push(a);
-    equiv_sets.push(b);
+    if (flags[s] & DFATable::ACCEPT_EOT) end = n;
+    return end;
+}
 
-    std::vector<std::vector<State>> nexts(dfa.size(), std::vector<State>(nfa->tokens.size(), INVALID_STATE));
-    for (State s : valids) {
-        for (auto [tok, next] : dfa[s]) {
-            nexts[s][tok] = next;
-        }
+bool DFA::match(std::string_view text) {
+    if (table.states() == 0) return false;
+    return longest(text, 0) == text.size();
+}
+
+// match starts by scanning backward with the reversed automaton
+size_t DFA::leftmost(std::string_view text, size_t pos, std::vector<bool>* marks) {
+    if (table.states() == 0) return NO_MATCH;
+    get_reversed_table();
+    auto scan = [&](size_t from, size_t to) {
+        return scan_back(text, from, to, marks);
     };
-    auto next_equal = [this, &nexts, &setid](State a, State b) {
-        for (size_t i = 0; i < nfa->tokens.size(); i++) {
-            if (setid[nexts[a][i]] != setid[nexts[b][i]]) return false;
+    if (marks) return scan(pos, text.size());
+    return leftmost_in_windows(text.size(), pos, nfa->max_length(), scan);
+}
+
+// starts in [from, to] of the matches ending at or before to, the smallest is returned
+size_t DFA::scan_back(std::string_view text, size_t from, size_t to, std::vector<bool>* marks) {
+    const DFATable& r = rdfa->table;
+    size_t first = NO_MATCH;
+    auto accept = [&](uint32_t s, size_t i) {
+        // the end of the reversed text is the beginning of text
+        if ((r.flags[s] & DFATable::ACCEPT) || (i == 0 && (r.flags[s] & DFATable::ACCEPT_EOT))) {
+            first = i;
+            if (marks) (*marks)[i] = true;
         }
-        return true;
     };
 
-    auto find_equiv = [&](std::vector<std::pair<State,std::vector<State>>>&mp, State s) {
-        for (auto& [x, p] : mp) {
-            if (next_equal(s, x)) {
-                p.push_back(s);
-                return;
-            }
+    // `$` only holds when the scan starts at the end of text
+    uint32_t s = to == text.size() ? r.initial_bot : r.initial;
+    if (s == DEAD_STATE) return NO_MATCH;
+    accept(s, to);
+    for (size_t i = to; i > from; i--) {
+        s = r.next(s, text[i-1]);
+        if (s == DEAD_STATE) break;
+        accept(s, i-1);
+    }
+    return first;
+}
+
+size_t LongestMatcher::leftmost_in_windows(size_t n, size_t pos, size_t max_len,
+        const std::function<size_t(size_t,size_t)>& scan) {
+    if (max_len == NO_MATCH) return scan(pos, n);
+    for (size_t from = pos, width = SEARCH_WINDOW;; width *= 2) {
+        size_t to = n - from > width + max_len ? from + width + max_len : n;
+        size_t start = scan(from, to);
+        // every match of a start up to to - max_len ends inside the window
+        if (to == n || (start != NO_MATCH && start + max_len <= to)) return start;
+        from = to - max_len + 1;
+    }
+}
+
+bool LongestMatcher::search(std::string_view text, Match& m, size_t pos) {
+    if (pos > text.size()) return false;
+    if (!prefilter.possible(text, pos)) return false;
+    // a match at the first candidate is the leftmost, a few are tried forward
+    // before the backward scan from the next one
+    for (int k = 0; k < PREFILTER_TRIES; k++) {
+        pos = prefilter.candidate(text, pos);
+        if (pos == NO_MATCH) return false;
+        if (!prefilter.has_prefixes()) break;
+        size_t end = longest(text, pos);
+        if (end != NO_MATCH) {
+            m = {pos, end};
+            return true;
         }
-        mp.emplace_back(s, std::vector<State>{s});
-    };
+        pos++;
+    }
+    pos = prefilter.candidate(text, pos);
+    if (pos == NO_MATCH) return false;
+    size_t start = leftmost(text, pos, nullptr);
+    if (start == NO_MATCH) return false;
+    m.start = start;
+    m.end = longest(text, start);
+    assert(m.end != NO_MATCH);
+    return true;
+}
+
+std::vector<Match> LongestMatcher::find_all(std::string_view text) {
+    std::vector<Match> res;
+    if (!prefilter.possible(text, 0)) return res;
+    size_t from = prefilter.candidate(text, 0);
+    if (from == NO_MATCH) return res;
+    std::vector<bool> starts(text.size() + 1, false);
+    if (leftmost(text, from, &starts) == NO_MATCH) return res;
+    for (size_t i = from; i <= text.size();) {
+        if (!starts[i]) {
+            i++;
+            continue;
+        }
+        Match m{i, longest(text, i)};
+        assert(m.end != NO_MATCH);
+        res.push_back(m);
+        i = after_match(m);
+    }
+    return res;
+}
+
+// valid states are reachable from the initial states and can reach an accept state
+void DFA::prune() {
+    valids.clear();
+    std::vector<bool> reached(dfa.size(), false);
+    std::vector<State> order;
+    for (State s : {state_initial, state_inner}) {
+        if (reached[s]) continue;
+        reached[s] = true;
+        order.push_back(s);
+    }
+    std::vector<std::vector<State>> prev(dfa.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        State s = order[i];
+        for (auto [tok, next] : dfa[s]) {
+            prev[next].push_back(s);
+            if (reached[next]) continue;
+            reached[next] = true;
+            order.push_back(next);
+        }
+    }
 
-    while (!equiv_sets.empty()) {
-        auto vec = equiv_sets.front();
-        equiv_sets.pop();
-        if (vec.size() <= 1) continue;
+    std::vector<State> stk;
+    for (State s : order) {
+        if (is_accepted(s)) {
+            valids.insert(s);
+            stk.push_back(s);
+        }
+    }
+    while (!stk.empty()) {
+        State s = stk.back(); stk.pop_back();
+        for (State p : prev[s]) {
+            if (valids.insert(p).second) stk.push_back(p);
+        }
+    }
+}
 
-        std::vector<std::pair<State,std::vector<State>>> mp;
-        for (State s : vec) {
-            find_equiv(mp, s);
+// Hopcroft partition refinement, each valid state -> the smallest state of its block
+std::vector<State> DFA::partition() {
+    // valid states and the dead state n, which absorbs the missing transitions
+    std::vector<State> states;
+    std::vector<State> idx(dfa.size(), INVALID_STATE);
+    for (State s = 0; s < dfa.size(); s++) {
+        if (!is_valid(s)) continue;
+        idx[s] = states.size();
+        states.push_back(s);
+    }
+    const size_t n = states.size();
+    const size_t k = nfa->tokens.size() - TOK_CLASS;
+
+    // inverse transitions: [token * (n+1) + target] -> sources
+    std::vector<uint32_t> inv_off(k * (n + 1) + 1, 0);
+    std::vector<uint32_t> inv_src;
+    auto target = [&](size_t i, Token tok) -> size_t {
+        if (i == n) return n;
+        auto it = dfa[states[i]].find(tok);
+        return it == dfa[states[i]].end() || !is_valid(it->second) ? n : idx[it->second];
+    };
+    for (size_t i = 0; i <= n; i++) {
+        for (size_t c = 0; c < k; c++) {
+            inv_off[c * (n + 1) + target(i, c + TOK_CLASS) + 1]++;
+        }
+    }
+    std::partial_sum(inv_off.begin(), inv_off.end(), inv_off.begin());
+    inv_src.resize(inv_off.back());
+    std::vector<uint32_t> fill(inv_off.begin(), inv_off.end() - 1);
+    for (size_t i = 0; i <= n; i++) {
+        for (size_t c = 0; c < k; c++) {
+            inv_src[fill[c * (n + 1) + target(i, c + TOK_CLASS)]++] = i;
+        }
+    }
+
+    // blocks are ranges of elem, marked elements are moved to the front of their block
+    std::vector<uint32_t> elem(n + 1), loc(n + 1), blk(n + 1);
+    std::vector<uint32_t> first, last, marked;
+    std::vector<bool> pending;
+    std::vector<uint32_t> work;
+
+    // initial partition by accept flags and accepted patterns, the dead state alone
+    std::map<std::tuple<int,uint32_t,uint32_t>,std::vector<uint32_t>> groups;
+    for (size_t i = 0; i < n; i++) {
+        State s = states[i];
+        auto [tag, eot_tag] = tags.empty() ? std::make_pair(0u, 0u) : tags[s];
+        groups[{terminals.count(s) + 2 * eot_terminals.count(s), tag, eot_tag}].push_back(i);
+    }
+    groups[{-1, 0, 0}].push_back(n);
+    for (auto& [key, g] : groups) {
+        uint32_t b = first.size();
+        first.push_back(first.empty() ? 0 : last.back());
+        last.push_back(first.back() + g.size());
+        marked.push_back(0);
+        pending.push_back(true);
+        work.push_back(b);
+        for (size_t j = 0; j < g.size(); j++) {
+            elem[first[b] + j] = g[j];
+            loc[g[j]] = first[b] + j;
+            blk[g[j]] = b;
         }
-        if (mp.size() > 1) {
-            for (auto& [x, xs] : mp) {
-                equiv_sets.push(xs);
-                for (auto y : xs) setid[y] = x;
+    }
+
+    std::vector<uint32_t> touched, splitter;
+    while (!work.empty()) {
+        uint32_t a = work.back();
+        work.pop_back();
+        pending[a] = false;
+        splitter.assign(elem.begin() + first[a], elem.begin() + last[a]);
+
+        for (size_t c = 0; c < k; c++) {
+            for (uint32_t t : splitter) {
+                size_t x = c * (n + 1) + t;
+                for (uint32_t j = inv_off[x]; j < inv_off[x + 1]; j++) {
+                    uint32_t s = inv_src[j];
+                    uint32_t b = blk[s];
+                    uint32_t m = first[b] + marked[b];
+                    if (loc[s] < m) continue;
+                    // swap s to the end of the marked part
+                    uint32_t o = elem[m];
+                    std::swap(elem[loc[s]], elem[m]);
+                    loc[o] = loc[s];
+                    loc[s] = m;
+                    if (marked[b]++ == 0) touched.push_back(b);
+                }
+            }
+
+            for (uint32_t b : touched) {
+                uint32_t m = marked[b];
+                marked[b] = 0;
+                if (m == last[b] - first[b]) continue;
+                // marked part becomes a new block
+                uint32_t nb = first.size();
+                first.push_back(first[b]);
+                last.push_back(first[b] + m);
+                marked.push_back(0);
+                first[b] += m;
+                for (uint32_t j = first[nb]; j < last[nb]; j++) {
+                    blk[elem[j]] = nb;
+                }
+                if (pending[b] || m <= last[b] - first[b]) {
+                    pending.push_back(true);
+                    work.push_back(nb);
+                } else {
+                    pending.push_back(false);
+                    pending[b] = true;
+                    work.push_back(b);
+                }
             }
+            touched.clear();
         }
     }
 
+    std::vector<State> rep(first.size(), INVALID_STATE);
+    for (size_t i = 0; i < n; i++) {
+        rep[blk[i]] = std::min(rep[blk[i]], states[i]);
+    }
+    std::vector<State> setid(dfa.size(), INVALID_STATE);
+    for (size_t i = 0; i < n; i++) {
+        setid[states[i]] = rep[blk[i]];
+    }
+    return setid;
+}
+
+// keep one state of each block and redirect the jumps to it
+void DFA::merge(const std::vector<State>& setid) {
     for (State s = 0; s < dfa.size(); s++) {
         auto& mp = dfa[s];
-        if (setid[s] != s) {
-            dfa[s].clear();
+        if (!is_valid(s) || setid[s] != s) {
+            mp.clear();
             continue;
         }
         for (auto it = mp.begin(); it != mp.end();) {
             State next = it->second;
             if (!is_valid(next)) {
                 it = mp.erase(it);
-                continue;;
-            } else {
-                it->second = setid[next];
+                continue;
             }
+            it->second = setid[next];
             ++it;
         }
     }
+    if (is_valid(state_inner)) {
+        state_inner = setid[state_inner];
+    }
     for (State s = 0; s < dfa.size(); s++) {
-        if (setid[s] != s) {
+        if (is_valid(s) && setid[s] != s) {
             valids.erase(s);
         }
     }
     LOG_DEBUG("DFA total invalid states: %zu\n", dfa.size()-valids.size());
 }
 
+void DFA::simplify() {
+    prune();
+    merge(partition());
+}
+
 void DFA::generate() {
 
     nfa_to_dfa();
 
     simplify();
+
+    freeze();
+
+    prefilter = Prefilter(nfa->literals);
 }
 
 #if 0
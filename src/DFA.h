@@ -6,14 +6,83 @@
 #include <set>
 #include <map>
 #include <stack>
+#include <tuple>
+#include <functional>
+#include <string_view>
 #include "Parser.h"
 #include "GraphBox.h"
+#include "Literals.h"
 
 using Token = size_t;
 using State = size_t;
-using Bits = std::vector<bool>;
+
+// packed set of nfa states
+struct Bits {
+    std::vector<uint64_t> words;
+
+    Bits(size_t n=0): words((n + 63) / 64, 0) {
+    }
+
+    bool test(size_t i) const {
+        return words[i >> 6] >> (i & 63) & 1;
+    }
+
+    void set(size_t i) {
+        words[i >> 6] |= (uint64_t)1 << (i & 63);
+    }
+
+    void reset(size_t i) {
+        words[i >> 6] &= ~((uint64_t)1 << (i & 63));
+    }
+
+    Bits& operator|=(const Bits& rhs) {
+        for (size_t i = 0; i < words.size(); i++) {
+            words[i] |= rhs.words[i];
+        }
+        return *this;
+    }
+
+    bool empty() const {
+        for (uint64_t w : words) {
+            if (w) return false;
+        }
+        return true;
+    }
+
+    bool operator==(const Bits& rhs) const {
+        return words == rhs.words;
+    }
+
+    bool operator!=(const Bits& rhs) const {
+        return words != rhs.words;
+    }
+
+    // call f for each state in the set, in order
+    template<typename F>
+    void each(F f) const {
+        for (size_t i = 0; i < words.size(); i++) {
+            for (uint64_t w = words[i]; w; w &= w - 1) {
+                f((i << 6) + __builtin_ctzll(w));
+            }
+        }
+    }
+
+    struct Hash {
+        size_t operator()(const Bits& b) const {
+            uint64_t h = 0x9E3779B97F4A7C15ull;
+            for (uint64_t w : b.words) {
+                h ^= w + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+            }
+            return h;
+        }
+    };
+};
+using CharRanges = std::vector<std::pair<uint32_t,uint32_t>>; // code point ranges
 
 #define TOK_EPSILON 0
+#define TOK_BOL     1   // `^`, only followed at the beginning of text
+#define TOK_EOL     2   // `$`, only followed at the end of text
+#define TOK_CLASS   3   // first byte class token
 #define EPSILON "ε"
 #define INVALID_TOKEN   INT_MAX
 #define INVALID_STATE   INT_MAX
@@ -24,36 +93,165 @@ class NFA {
 
 public:
     friend class DFA;
+    friend class LazyDFA;
+    friend class PikeVM;
 
     NFA(bool color);
 
     void generate(ExprNode* expr, bool utf8_encoding);
+    // union of the expressions, pattern i accepts at finals[i]. Unless anchored,
+    // a match may start anywhere in the text
+    void generate(const std::vector<ExprNode*>& exprs, bool utf8_encoding, bool anchored=false);
     void dump(std::ostream& os=std::cout);
 
+    void closure(Bits& b, Token anchor=TOK_EPSILON) const;
+    Bits move(const Bits& b, Token t) const;
+    // byte -> class map over the byte class tokens, class 0 holds the bytes no edge accepts.
+    // return the number of classes
+    uint32_t byte_classes(uint16_t classes[256]) const;
+    // automaton of the reversed language, with any byte looping on its start,
+    // so scanning text backward it accepts at every position where a match starts
+    NFA reverse() const;
+
+    size_t states() const {
+        return saves.size();
+    }
+
+    // literals of every match, unknown for a set of patterns
+    const Literals& get_literals() const {
+        return literals;
+    }
+
+    // bytes of the longest match, NO_MATCH if unbounded or unknown for a set of patterns
+    size_t max_length() const {
+        return max_len;
+    }
+
 private:
-    State new_state();
+    void build(ExprNode* expr, State start, State end);
+    Literals extract_literals(ExprNode* expr);
+    size_t longest_path() const;
+    State new_state(int save=-1);
     void add_jump(State a, Token t, State b);
-    Token get_token(const std::string& tok);
-    void simplify();
+    void add_range(State a, uint8_t lo, uint8_t hi, State b);
+    void add_chars(State a, const CharRanges& chars, State b, bool wide=false);
+    void node_chars(ExprNode* node, CharRanges& chars, CharRanges& wide);
+    void build_classes();
+    void finalize();
 
 private:
     std::vector<std::string> tokens;
-    std::unordered_map<std::string,Token> tokenId;
-    std::vector<std::unordered_map<Token,std::set<State>>> nfa; // state: {tok:[state...]} ...
+    // edges while building, in insertion order
+    struct Jump {
+        uint32_t from;
+        uint32_t tok;
+        uint32_t to;
+    };
+    std::vector<Jump> jumps;
+
+    // finalized edges of state s: [off[s], off[s+1]) of toks/targets, sorted by token,
+    // and epsilon edges [eps_off[s], eps_off[s+1]) of eps_targets, in priority order
+    std::vector<uint32_t> off, toks, targets;
+    std::vector<uint32_t> eps_off, eps_targets;
+    std::vector<int> saves;     // capture slot recorded when entering the state, -1 if none
+    std::vector<std::string> group_names; // group id -> name, group 0 is the whole match
+    std::vector<std::tuple<State,uint8_t,uint8_t,State>> ranges; // byte range edges, split into classes at last
+    Token byte_token[256];  // byte -> class token, INVALID_TOKEN if no edge accepts it
+    std::vector<State> finals;  // accept state of each pattern of a set, empty for a single expression
+    Literals literals;
+    size_t max_len = std::string::npos;
     static State state_initial;
     static State state_final;
     static Token tok_epsilon;
     bool color;
+    bool utf8;
 };
 
 class DFACanvas;
 
-class DFA {
+// [start, end) byte offsets of a match in the input text
+struct Match {
+    size_t start = 0;
+    size_t end = 0;
+
+    size_t length() const {
+        return end - start;
+    }
+};
+
+#define DEAD_STATE 0
+#define NO_MATCH std::string::npos
+#define PREFILTER_TRIES 4   // prefix candidates matched forward in a search
+#define SEARCH_WINDOW 256   // bytes the first backward scan of a search covers, doubled after
+
+// next search position after m, empty matches are stepped over
+static inline size_t after_match(const Match& m) {
+    return m.end > m.start ? m.end : m.end + 1;
+}
+
+// search and find_all of the leftmost-longest automata. Match starts come from one
+// backward scan of the reversed automaton, ends from the forward longest scan,
+// so a search costs time in proportion to the text, or to the distance to its match
+// when the matches have a bounded length.
+class LongestMatcher {
+public:
+    virtual ~LongestMatcher() {}
+
+    // leftmost-longest match starting at or after pos
+    bool search(std::string_view text, Match& m, size_t pos=0);
+    // all non-overlapping leftmost-longest matches
+    std::vector<Match> find_all(std::string_view text);
+
+protected:
+    // leftmost match start at or after pos, NO_MATCH if none. All starts are set in marks if given
+    virtual size_t leftmost(std::string_view text, size_t pos, std::vector<bool>* marks) = 0;
+    // end of the longest match starting at pos, NO_MATCH if none
+    virtual size_t longest(std::string_view text, size_t pos) = 0;
+    // leftmost start at or after pos, scan(from, to) is the smallest start in [from, to] of the
+    // matches ending at or before to. With matches at most max_len bytes long, the windows
+    // grow from pos so a search costs time in proportion to the distance to its match
+    static size_t leftmost_in_windows(size_t n, size_t pos, size_t max_len,
+        const std::function<size_t(size_t,size_t)>& scan);
+
+protected:
+    Prefilter prefilter;    // text skipped before the automaton runs
+};
+
+// frozen, read-only form of a DFA for the hot path
+struct DFATable {
+    enum Flag: uint8_t {
+        ACCEPT = 0x1,       // accepted anywhere
+        ACCEPT_EOT = 0x2,   // accepted at the end of text (`$`)
+    };
+
+    uint32_t alphabet = 0;              // number of byte classes
+    uint32_t initial = DEAD_STATE;      // start state inside the text
+    uint32_t initial_bot = DEAD_STATE;  // start state at the beginning of text (`^`)
+    uint16_t classes[256] = {0};        // byte -> class, up to 257 classes with the dead one
+    std::vector<uint32_t> trans;        // [state * alphabet + class] -> state, row 0 is dead
+    std::vector<uint8_t> flags;         // accept flags of each state
+    // patterns of a set accepted in each state, as ids of pattern sets. empty for a single expression
+    std::vector<uint32_t> tags;         // [state] -> patterns accepted anywhere
+    std::vector<uint32_t> eot_tags;     // [state] -> patterns accepted at the end of text
+    std::vector<uint32_t> set_off;      // patterns of set k: set_ids[set_off[k], set_off[k+1]), set 0 is empty
+    std::vector<uint32_t> set_ids;
+
+    size_t states() const {
+        return flags.size();
+    }
+
+    uint32_t next(uint32_t s, unsigned char c) const {
+        return trans[s * alphabet + classes[c]];
+    }
+};
+
+class DFA: public LongestMatcher {
 public:
     // friend class DFAGraph;
     friend class DFACanvas;
+    friend struct DFABench;
 
-    DFA(NFA* nfa): nfa(nfa), state_initial(0) {
+    DFA(NFA* nfa): nfa(nfa), state_initial(0), state_inner(0) {
     }
 
     void generate();
@@ -66,18 +264,42 @@ public:
     std::string token_name(Token t);
     const std::vector<std::string> get_tokens();
 
+    // whole text is accepted by the automaton
+    bool match(std::string_view text);
+
+    const DFATable& get_table();
+    // table of the reversed automaton for match starts, built on the first call
+    const DFATable& get_reversed_table();
+
 private:
     bool is_color();
+    bool is_accepted_eot(State s);
+    void freeze();
+    size_t leftmost(std::string_view text, size_t pos, std::vector<bool>* marks);
+    size_t longest(std::string_view text, size_t pos);
+    size_t scan_back(std::string_view text, size_t from, size_t to, std::vector<bool>* marks);
     void nfa_to_dfa();
+    void prune();
+    std::vector<State> partition();
+    void merge(const std::vector<State>& setid);
     void simplify();
     void add_jump(State a, Token t, State b);
 
 private:
     std::vector<std::unordered_map<Token,State>> dfa;
-    std::unordered_set<State> terminals;
+    std::unordered_set<State> terminals;     // accepted anywhere
+    std::unordered_set<State> eot_terminals; // accepted at the end of text
     std::unordered_set<State> valids;
     NFA* nfa;
-    State state_initial;
+    State state_initial;  // start at the beginning of text
+    State state_inner;    // start inside the text, same as state_initial without `^`
+    DFATable table;
+    // pattern sets of the states, for an nfa of several patterns
+    std::vector<Bits> pattern_sets;                     // set 0 is empty
+    std::vector<std::pair<uint32_t,uint32_t>> tags;     // [state] -> {accepted anywhere, at the end of text}
+    // reversed automaton for match starts, built on the first search
+    std::unique_ptr<NFA> rnfa;
+    std::unique_ptr<DFA> rdfa;
 };
 
 #if 0
@@ -6,7 +6,7 @@
 #define BLOCK_WIDTH 7
 #define BLOCK_HEIGHT 3
 #define MIN_LINE_WIDTH 3
-static size_t s_line_width = 3;
+static thread_local size_t s_line_width = 3;
 
 static inline size_t linkHash(State a, State b, Token t) {
     return (a<<20)|(b<<10)|t;
@@ -299,7 +299,7 @@ void DFACanvas::dump(std::ostream& os) {
         if (omit_row.count(i)) continue;
         for (size_t j = 0; j < w; ++j) {
             if (omit_col.count(j)) continue;
-            std::string s = canvas->Get({i,j});
+            const std::string& s = canvas->Get({i,j});
             os << s;
             sz += s.size();
         }
@@ -358,7 +358,7 @@ void DFACanvas::postprocess() {
         bool vline = false;
         bool hline = false;
         for (size_t j = 0; j < w; ++j) {
-            std::string s = canvas->Get({i,j});
+            const std::string& s = canvas->Get({i,j});
             if (str_empty(s)) continue;
             if (s == Line::HORIZON) {
                 hline = true;
@@ -380,7 +380,7 @@ void DFACanvas::postprocess() {
         bool vline = false;
         bool hline = false;
         for (size_t i = 0; i < h; i++) {
-            std::string s = canvas->Get({i,j});
+            const std::string& s = canvas->Get({i,j});
             if (str_empty(s)) continue;
             if (s == Line::HORIZON) {
                 hline = true;
@@ -0,0 +1,124 @@
+#include <iomanip>
+#include "DFACode.h"
+#include "utils.h"
+
+DFACode::DFACode(DFA* dfa, const std::string& expr, const std::string& name)
+    : dfa(dfa), expr(expr), name(name) {
+}
+
+// smallest unsigned type holding values below n
+static const char* uint_type(size_t n) {
+    if (n <= 0x100) return "uint8_t";
+    if (n <= 0x10000) return "uint16_t";
+    return "uint32_t";
+}
+
+// byte as it may appear inside a // comment
+static std::string comment_byte(int c) {
+    std::stringstream ss;
+    if (c > ' ' && c < 0x7F && c != '\\') {
+        ss << (char)c;
+    } else {
+        ss << "\\x" << std::hex << std::setw(2) << std::setfill('0') << c;
+    }
+    return ss.str();
+}
+
+void DFACode::dump_classes(std::ostream& os, const char* type) {
+    const DFATable& t = dfa->get_table();
+
+    // bytes of each class, as ranges
+    std::vector<std::string> members(t.alphabet);
+    for (int c = 0; c < 256; c++) {
+        int d = c;
+        while (d + 1 < 256 && t.classes[d+1] == t.classes[c]) d++;
+        std::string& m = members[t.classes[c]];
+        if (!m.empty()) m += " ";
+        m += comment_byte(c);
+        if (d > c) m += "-" + comment_byte(d);
+        c = d;
+    }
+    for (uint32_t k = 1; k < t.alphabet; k++) {
+        os << "    // class " << k << ": [" << members[k] << "]\n";
+    }
+
+    os << "    static constexpr " << type << " classes[256] = {";
+    for (int c = 0; c < 256; c++) {
+        os << (c % 16 == 0 ? "\n        " : " ") << t.classes[c] << ",";
+    }
+    os << "\n    };\n";
+}
+
+void DFACode::dump_trans(std::ostream& os, const char* type) {
+    const DFATable& t = dfa->get_table();
+    os << "    static constexpr " << type << " trans[STATES][CLASSES] = {\n";
+    for (size_t s = 0; s < t.states(); s++) {
+        os << "        {";
+        for (uint32_t k = 0; k < t.alphabet; k++) {
+            os << (k ? ", " : "") << t.trans[s * t.alphabet + k];
+        }
+        os << "},";
+        if (s == DEAD_STATE) os << " // dead";
+        os << "\n";
+    }
+    os << "    };\n";
+
+    os << "    static constexpr uint8_t flags[STATES] = {";
+    for (size_t s = 0; s < t.states(); s++) {
+        os << (s % 16 == 0 ? "\n        " : " ") << (int)t.flags[s] << ",";
+    }
+    os << "\n    };\n";
+}
+
+void DFACode::dump(std::ostream& os) {
+    const DFATable& t = dfa->get_table();
+    if (t.states() == 0) {
+        throw std::runtime_error("DFA is not generated");
+    }
+
+    os << "// Generated by regexparser " << APP_VERSION << ", do not edit.\n"
+       << "// Regular Expression: " << expr << "\n"
+       << "// " << t.states() << " states x " << t.alphabet << " byte classes, state 0 is dead\n"
+       << "#pragma once\n"
+       << "\n"
+       << "#include <cstddef>\n"
+       << "#include <cstdint>\n"
+       << "#include <string_view>\n"
+       << "\n"
+       << "struct " << name << " {\n"
+       << "    static constexpr uint32_t STATES = " << t.states() << ";\n"
+       << "    static constexpr uint32_t CLASSES = " << t.alphabet << ";\n"
+       << "    static constexpr uint32_t INITIAL = " << t.initial << ";      // start inside the text\n"
+       << "    static constexpr uint32_t INITIAL_BOT = " << t.initial_bot << ";  // start at the beginning of text\n"
+       << "    static constexpr uint8_t ACCEPT = " << (int)DFATable::ACCEPT << ";\n"
+       << "    static constexpr uint8_t ACCEPT_EOT = " << (int)DFATable::ACCEPT_EOT << ";  // accepted at the end of text\n"
+       << "\n";
+
+    dump_classes(os, uint_type(t.alphabet));
+    dump_trans(os, uint_type(t.states()));
+
+    os << "\n"
+       << "    // whole text is accepted\n"
+       << "    static constexpr bool match(std::string_view text) {\n"
+       << "        uint32_t s = INITIAL_BOT;\n"
+       << "        for (unsigned char c : text) {\n"
+       << "            s = trans[s][classes[c]];\n"
+       << "            if (s == 0) return false;\n"
+       << "        }\n"
+       << "        return flags[s] != 0;\n"
+       << "    }\n"
+       << "\n"
+       << "    // end of the longest match starting at pos, npos if none\n"
+       << "    static constexpr size_t longest(std::string_view text, size_t pos = 0) {\n"
+       << "        uint32_t s = pos == 0 ? INITIAL_BOT : INITIAL;\n"
+       << "        size_t end = std::string_view::npos;\n"
+       << "        if ((flags[s] & ACCEPT) || (pos == text.size() && (flags[s] & ACCEPT_EOT))) end = pos;\n"
+       << "        for (size_t i = pos; i < text.size() && s != 0; i++) {\n"
+       << "            s = trans[s][classes[(unsigned char)text[i]]];\n"
+       << "            if (flags[s] & ACCEPT) end = i + 1;\n"
+       << "            else if (i + 1 == text.size() && (flags[s] & ACCEPT_EOT)) end = i + 1;\n"
+       << "        }\n"
+       << "        return end;\n"
+       << "    }\n"
+       << "};\n";
+}
@@ -0,0 +1,22 @@
+#ifndef __DFACODE_H__
+#define __DFACODE_H__
+
+#include "DFA.h"
+
+// emit the frozen table of a generated DFA as a self-contained C++ matcher,
+// a struct of constexpr tables with match() and longest()
+class DFACode {
+public:
+    DFACode(DFA* dfa, const std::string& expr, const std::string& name="RegexMatcher");
+    void dump(std::ostream& os=std::cout);
+
+private:
+    void dump_classes(std::ostream& os, const char* type);
+    void dump_trans(std::ostream& os, const char* type);
+
+    DFA* dfa;
+    std::string expr;
+    std::string name;
+};
+
+#endif // __DFACODE_H__
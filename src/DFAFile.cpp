@@ -0,0 +1,294 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include "DFAFile.h"
+
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+
+// the image is built in memory, sections appended 8-byte aligned
+struct ImageWriter {
+    std::string buf;
+
+    template<typename T>
+    uint64_t add(const T* data, size_t n) {
+        if (n == 0) return 0;
+        buf.resize((buf.size() + 7) & ~(size_t)7, '\0');
+        uint64_t off = buf.size();
+        buf.append((const char*)data, n * sizeof(T));
+        return off;
+    }
+
+    DFAFileTable add_table(const DFATable& t) {
+        DFAFileTable ft = {};
+        ft.alphabet = t.alphabet;
+        ft.initial = t.initial;
+        ft.initial_bot = t.initial_bot;
+        ft.states = t.states();
+        ft.sets = t.set_off.empty() ? 0 : t.set_off.size() - 1;
+        ft.ids = t.set_ids.size();
+        ft.classes = add(t.classes, 256);
+        ft.trans = add(t.trans.data(), t.trans.size());
+        ft.flags = add(t.flags.data(), t.flags.size());
+        ft.tags = add(t.tags.data(), t.tags.size());
+        ft.eot_tags = add(t.eot_tags.data(), t.eot_tags.size());
+        ft.set_off = add(t.set_off.data(), t.set_off.size());
+        ft.set_ids = add(t.set_ids.data(), t.set_ids.size());
+        return ft;
+    }
+};
+
+} // namespace
+
+void write_dfa_file(std::ostream& os, const DFATable& table, const DFATable* reversed,
+        size_t max_len, uint32_t patterns, bool anchored) {
+    DFAFileHeader h = {};
+    memcpy(h.magic, DFA_FILE_MAGIC, sizeof(h.magic));
+    h.version = DFA_FILE_VERSION;
+    h.byte_order = DFA_FILE_BYTE_ORDER;
+    h.max_len = max_len == NO_MATCH ? UINT64_MAX : max_len;
+    h.patterns = patterns;
+    h.anchored = anchored;
+    h.tables = reversed ? 2 : 1;
+
+    ImageWriter w;
+    size_t head = sizeof(h) + h.tables * sizeof(DFAFileTable);
+    w.buf.assign(head, '\0');
+    DFAFileTable tables[2] = {w.add_table(table), reversed ? w.add_table(*reversed) : DFAFileTable{}};
+    h.size = w.buf.size();
+    memcpy(&w.buf[0], &h, sizeof(h));
+    memcpy(&w.buf[sizeof(h)], tables, h.tables * sizeof(DFAFileTable));
+    os.write(w.buf.data(), w.buf.size());
+}
+
+MappedDFA::MappedDFA(const std::string& path) {
+#ifdef _WIN32
+    // no shared mapping, the image is read into memory
+    std::ifstream is(path, std::ios::binary | std::ios::ate);
+    if (!is) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    size = is.tellg();
+    copy.resize((size + 7) / 8);
+    is.seekg(0);
+    is.read((char*)copy.data(), size);
+    base = (const char*)copy.data();
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path + ": " + strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(DFAFileHeader)) {
+        close(fd);
+        throw std::runtime_error("Not a DFA image: " + path);
+    }
+    size = st.st_size;
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        throw std::runtime_error("Failed to map " + path + ": " + strerror(errno));
+    }
+    base = (const char*)p;
+#endif
+    try {
+        load();
+    } catch (const std::exception& e) {
+#ifndef _WIN32
+        munmap((void*)base, size);
+#endif
+        throw std::runtime_error("Invalid DFA image " + path + ": " + e.what());
+    }
+}
+
+MappedDFA::~MappedDFA() {
+#ifndef _WIN32
+    munmap((void*)base, size);
+#endif
+}
+
+void MappedDFA::load() {
+    if (size < sizeof(DFAFileHeader)) {
+        throw std::runtime_error("truncated header");
+    }
+    header = (const DFAFileHeader*)base;
+    if (memcmp(header->magic, DFA_FILE_MAGIC, sizeof(header->magic)) != 0) {
+        throw std::runtime_error("bad magic");
+    }
+    if (header->byte_order != DFA_FILE_BYTE_ORDER) {
+        throw std::runtime_error("written with another byte order");
+    }
+    if (header->version != DFA_FILE_VERSION) {
+        throw std::runtime_error("version " + std::to_string(header->version) + " isn't supported");
+    }
+    if (header->size != size || header->tables < 1 || header->tables > 2
+        || size < sizeof(DFAFileHeader) + header->tables * sizeof(DFAFileTable)) {
+        throw std::runtime_error("truncated image");
+    }
+    const DFAFileTable* tables = (const DFAFileTable*)(base + sizeof(DFAFileHeader));
+    forward = load_table(tables[0]);
+    if (header->tables == 2) reversed = load_table(tables[1]);
+    max_len = header->max_len == UINT64_MAX ? NO_MATCH : header->max_len;
+}
+
+// pointers into the image, after checking each state and id stays in its table
+MappedDFA::Table MappedDFA::load_table(const DFAFileTable& ft) const {
+    auto section = [this](uint64_t off, uint64_t n, size_t elem, size_t align) -> const char* {
+        if (n == 0) return nullptr;
+        if (off % align || off > size || n > (size - off) / elem) {
+            throw std::runtime_error("section out of bounds");
+        }
+        return base + off;
+    };
+
+    Table t;
+    t.alphabet = ft.alphabet;
+    t.initial = ft.initial;
+    t.initial_bot = ft.initial_bot;
+    t.states = ft.states;
+    t.sets = ft.sets;
+    if (t.states == 0) return t;
+    if (t.alphabet == 0 || t.alphabet > 257 || t.initial >= t.states || t.initial_bot >= t.states) {
+        throw std::runtime_error("bad table header");
+    }
+    t.classes = (const uint16_t*)section(ft.classes, 256, sizeof(uint16_t), 2);
+    t.trans = (const uint32_t*)section(ft.trans, (uint64_t)t.states * t.alphabet, sizeof(uint32_t), 4);
+    t.flags = (const uint8_t*)section(ft.flags, t.states, 1, 1);
+    if (!t.classes || !t.trans || !t.flags) {
+        throw std::runtime_error("missing section");
+    }
+    for (int c = 0; c < 256; c++) {
+        if (t.classes[c] >= t.alphabet) throw std::runtime_error("byte class out of range");
+    }
+    for (uint64_t i = 0; i < (uint64_t)t.states * t.alphabet; i++) {
+        if (t.trans[i] >= t.states) throw std::runtime_error("transition out of range");
+    }
+
+    if (ft.sets == 0) return t;
+    t.tags = (const uint32_t*)section(ft.tags, t.states, sizeof(uint32_t), 4);
+    t.eot_tags = (const uint32_t*)section(ft.eot_tags, t.states, sizeof(uint32_t), 4);
+    t.set_off = (const uint32_t*)section(ft.set_off, (uint64_t)ft.sets + 1, sizeof(uint32_t), 4);
+    t.set_ids = (const uint32_t*)section(ft.set_ids, ft.ids, sizeof(uint32_t), 4);
+    if (!t.tags || !t.eot_tags || !t.set_off) {
+        throw std::runtime_error("missing pattern sets");
+    }
+    for (uint32_t s = 0; s < t.states; s++) {
+        if (t.tags[s] >= ft.sets || t.eot_tags[s] >= ft.sets) throw std::runtime_error("pattern set out of range");
+    }
+    for (uint32_t k = 0; k < ft.sets; k++) {
+        if (t.set_off[k] > t.set_off[k+1]) throw std::runtime_error("bad pattern set");
+    }
+    if (t.set_off[ft.sets] > ft.ids) throw std::runtime_error("bad pattern set");
+    for (uint32_t i = 0; i < ft.ids; i++) {
+        if (t.set_ids[i] >= header->patterns) throw std::runtime_error("pattern id out of range");
+    }
+    return t;
+}
+
+bool MappedDFA::match(std::string_view text) {
+    if (forward.states == 0) return false;
+    return longest(text, 0) == text.size();
+}
+
+// same as DFA::longest over the mapped table
+size_t MappedDFA::longest(std::string_view text, size_t pos) {
+    const Table& t = forward;
+    const size_t n = text.size();
+    if (t.states == 0) return NO_MATCH;
+    uint32_t s = pos == 0 ? t.initial_bot : t.initial;
+    if (s == DEAD_STATE) return NO_MATCH;
+
+    size_t end = NO_MATCH;
+    if ((t.flags[s] & DFATable::ACCEPT) || (pos == n && (t.flags[s] & DFATable::ACCEPT_EOT))) {
+        end = pos;
+    }
+    for (size_t i = pos; i < n; i++) {
+        s = t.next(s, text[i]);
+        if (s == DEAD_STATE) return end;
+        if (t.flags[s] & DFATable::ACCEPT) end = i+1;
+    }
+    if (t.flags[s] & DFATable::ACCEPT_EOT) end = n;
+    return end;
+}
+
+size_t MappedDFA::leftmost(std::string_view text, size_t pos, std::vector<bool>* marks) {
+    if (forward.states == 0) return NO_MATCH;
+    if (reversed.states == 0) {
+        throw std::runtime_error("DFA image has no reversed table for search");
+    }
+    auto scan = [&](size_t from, size_t to) {
+        return scan_back(text, from, to, marks);
+    };
+    if (marks) return scan(pos, text.size());
+    return leftmost_in_windows(text.size(), pos, max_len, scan);
+}
+
+// same as DFA::scan_back over the mapped reversed table
+size_t MappedDFA::scan_back(std::string_view text, size_t from, size_t to, std::vector<bool>* marks) {
+    const Table& r = reversed;
+    size_t first = NO_MATCH;
+    auto accept = [&](uint32_t s, size_t i) {
+        if ((r.flags[s] & DFATable::ACCEPT) || (i == 0 && (r.flags[s] & DFATable::ACCEPT_EOT))) {
+            first = i;
+            if (marks) (*marks)[i] = true;
+        }
+    };
+
+    uint32_t s = to == text.size() ? r.initial_bot : r.initial;
+    if (s == DEAD_STATE) return NO_MATCH;
+    accept(s, to);
+    for (size_t i = to; i > from; i--) {
+        s = r.next(s, text[i-1]);
+        if (s == DEAD_STATE) break;
+        accept(s, i-1);
+    }
+    return first;
+}
+
+// same as RegexSet::matches over the mapped table
+std::vector<size_t> MappedDFA::matches(std::string_view text) const {
+    if (header->patterns == 0) {
+        throw std::runtime_error("DFA image isn't a pattern set");
+    }
+    std::vector<size_t> res;
+    const Table& t = forward;
+    if (t.states == 0 || t.sets == 0) return res;
+
+    std::vector<bool> seen(t.sets, false);
+    std::vector<bool> found(header->patterns, false);
+    size_t left = header->patterns;
+    auto collect = [&](uint32_t k) {
+        if (k == 0 || seen[k]) return;
+        seen[k] = true;
+        for (uint32_t i = t.set_off[k]; i < t.set_off[k+1]; i++) {
+            uint32_t p = t.set_ids[i];
+            if (!found[p]) {
+                found[p] = true;
+                left--;
+            }
+        }
+    };
+
+    bool anchored = header->anchored;
+    uint32_t s = t.initial_bot;
+    if (!anchored) collect(t.tags[s]);
+    for (size_t i = 0; i < text.size() && s != DEAD_STATE && left > 0; i++) {
+        s = t.next(s, text[i]);
+        if (!anchored) collect(t.tags[s]);
+    }
+    if (s != DEAD_STATE) {
+        if (anchored) collect(t.tags[s]);
+        collect(t.eot_tags[s]);
+    }
+
+    for (size_t p = 0; p < found.size(); p++) {
+        if (found[p]) res.push_back(p);
+    }
+    return res;
+}
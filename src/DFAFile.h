@@ -0,0 +1,109 @@
+#ifndef __DFA_FILE_H__
+#define __DFA_FILE_H__
+
+#include "DFA.h"
+
+#define DFA_FILE_MAGIC      "RXDFABIN"
+#define DFA_FILE_VERSION    1
+#define DFA_FILE_BYTE_ORDER 0x01020304u
+
+// -f dfabin image of frozen DFA tables: the header, the DFAFileTable of the DFA and of its
+// reversed DFA if any, then their sections. Sections are 8-byte aligned and located by
+// their offset from the start of the image, so it is matched in place wherever it is mapped.
+// Integers have the byte order of the writer
+struct DFAFileHeader {
+    char magic[8];          // DFA_FILE_MAGIC, not terminated
+    uint32_t version;       // DFA_FILE_VERSION
+    uint32_t byte_order;    // DFA_FILE_BYTE_ORDER as written
+    uint64_t size;          // bytes of the image
+    uint64_t max_len;       // bytes of the longest match, UINT64_MAX if unbounded
+    uint32_t patterns;      // patterns of a set, 0 for a single expression
+    uint32_t anchored;      // patterns of the set match the whole text
+    uint32_t tables;        // 1, or 2 with the reversed DFA for search
+    uint32_t reserved;
+};
+
+// a DFATable in the image, absent sections have offset 0
+struct DFAFileTable {
+    uint32_t alphabet;
+    uint32_t initial;
+    uint32_t initial_bot;
+    uint32_t states;
+    uint32_t sets;          // pattern sets, with the empty set 0
+    uint32_t ids;           // entries of set_ids
+    uint64_t classes;       // uint16_t[256]
+    uint64_t trans;         // uint32_t[states * alphabet]
+    uint64_t flags;         // uint8_t[states]
+    uint64_t tags;          // uint32_t[states]
+    uint64_t eot_tags;      // uint32_t[states]
+    uint64_t set_off;       // uint32_t[sets + 1]
+    uint64_t set_ids;       // uint32_t[ids]
+};
+
+// write the image of table, with the reversed table for search if given
+void write_dfa_file(std::ostream& os, const DFATable& table, const DFATable* reversed,
+    size_t max_len, uint32_t patterns=0, bool anchored=false);
+
+// read-only mapping of an image written by write_dfa_file. Matching reads the mapped pages
+// in place, so loading costs one validating pass and processes share the physical copy
+class MappedDFA: public LongestMatcher {
+public:
+    // throws std::runtime_error if the file can't be mapped or isn't a valid image
+    MappedDFA(const std::string& path);
+    ~MappedDFA();
+    MappedDFA(const MappedDFA&) = delete;
+    MappedDFA& operator=(const MappedDFA&) = delete;
+
+    // whole text is accepted by the automaton
+    bool match(std::string_view text);
+    // ids of the patterns of a set matching text, in increasing order
+    std::vector<size_t> matches(std::string_view text) const;
+
+    size_t states() const {
+        return forward.states;
+    }
+
+    size_t patterns() const {
+        return header->patterns;
+    }
+
+private:
+    // a table of the image, fields as in DFATable
+    struct Table {
+        uint32_t alphabet = 0;
+        uint32_t initial = DEAD_STATE;
+        uint32_t initial_bot = DEAD_STATE;
+        uint32_t states = 0;
+        uint32_t sets = 0;
+        const uint16_t* classes = nullptr;
+        const uint32_t* trans = nullptr;
+        const uint8_t* flags = nullptr;
+        const uint32_t* tags = nullptr;
+        const uint32_t* eot_tags = nullptr;
+        const uint32_t* set_off = nullptr;
+        const uint32_t* set_ids = nullptr;
+
+        uint32_t next(uint32_t s, unsigned char c) const {
+            return trans[s * alphabet + classes[c]];
+        }
+    };
+
+    void load();
+    Table load_table(const DFAFileTable& t) const;
+    size_t leftmost(std::string_view text, size_t pos, std::vector<bool>* marks);
+    size_t longest(std::string_view text, size_t pos);
+    size_t scan_back(std::string_view text, size_t from, size_t to, std::vector<bool>* marks);
+
+private:
+    const char* base = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    std::vector<uint64_t> copy;     // the image read into memory
+#endif
+    const DFAFileHeader* header = nullptr;
+    Table forward;
+    Table reversed;         // no states without the reversed DFA
+    size_t max_len = NO_MATCH;
+};
+
+#endif // __DFA_FILE_H__
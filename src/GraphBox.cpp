@@ -13,29 +13,30 @@ static const std::vector<std::vector<std::string>> s_tables = {
     {" ", " ", " ", " ", " ", " ", " ", " ", " ", " "}, // Empty
 };
 
-static std::unordered_map<std::string,std::string> s_map;
-
 std::string get_table_line(TableId id, TableLine t) {
     return s_tables[static_cast<int>(id)][t];
 }
 
 std::string rotate(const std::string& s) {
     if (s.size() <= 1) return s;
-    if (s_map.empty()) {
+    // read-only table built on first use, safe across threads
+    static const std::unordered_map<std::string,std::string> s_map = []() {
+        std::unordered_map<std::string,std::string> m;
         for (size_t i=0; i<s_tables.size()-1; i++) {
             const auto& tb = s_tables[i];
-            s_map[tb[TAB_LEFT_TOP]] = tb[TAB_RIGHT_TOP];
-            s_map[tb[TAB_RIGHT_TOP]] = tb[TAB_RIGHT_BOTTOM];
-            s_map[tb[TAB_RIGHT_BOTTOM]] = tb[TAB_LEFT_BOTTOM];
-            s_map[tb[TAB_LEFT_BOTTOM]] = tb[TAB_LEFT_TOP];
-            s_map[tb[TAB_H_LINE]] = tb[TAB_V_LINE];
-            s_map[tb[TAB_V_LINE]] = tb[TAB_H_LINE];
-            s_map[tb[TAB_RIGHT_T]] = tb[TAB_DOWN_T];
-            s_map[tb[TAB_DOWN_T]] = tb[TAB_LEFT_T];
-            s_map[tb[TAB_LEFT_T]] = tb[TAB_UP_T];
-            s_map[tb[TAB_UP_T]] = tb[TAB_RIGHT_T];
+            m[tb[TAB_LEFT_TOP]] = tb[TAB_RIGHT_TOP];
+            m[tb[TAB_RIGHT_TOP]] = tb[TAB_RIGHT_BOTTOM];
+            m[tb[TAB_RIGHT_BOTTOM]] = tb[TAB_LEFT_BOTTOM];
+            m[tb[TAB_LEFT_BOTTOM]] = tb[TAB_LEFT_TOP];
+            m[tb[TAB_H_LINE]] = tb[TAB_V_LINE];
+            m[tb[TAB_V_LINE]] = tb[TAB_H_LINE];
+            m[tb[TAB_RIGHT_T]] = tb[TAB_DOWN_T];
+            m[tb[TAB_DOWN_T]] = tb[TAB_LEFT_T];
+            m[tb[TAB_LEFT_T]] = tb[TAB_UP_T];
+            m[tb[TAB_UP_T]] = tb[TAB_RIGHT_T];
         }
-    }
+        return m;
+    }();
     auto it = s_map.find(s);
     if (it != s_map.end()) return it->second;
     return s;
@@ -316,10 +317,40 @@ Block block_concat(const Block& a, const Block& b, size_t spaces, Dir d) {
     return rows;
 }
 
-std::unique_ptr<RootBox> expr_to_box(ExprNode* expr) {
+// structure of the subtree under box p: the node's own fields and the ids of the child
+// boxes, so equal keys mean identical subtrees
+static std::string structure_key(ExprNode* node, GraphBox* p) {
+    std::string k = std::to_string(static_cast<int>(p->get_type()));
+    if (node == nullptr) {
+        k += "e";
+    } else if (node->isType(ExprType::T_CLASS)) {
+        k += static_cast<Class*>(node)->negative ? "^" : "";
+    } else if (node->isType(ExprType::T_GROUP)) {
+        auto group = static_cast<Group*>(node);
+        k += "#" + std::to_string(group->id) + "<" + group->name;
+    } else if (node->isType(ExprType::T_QUANTIFIER)) {
+        auto q = static_cast<Quantifier*>(node);
+        k += get_quantifier(q->min, q->max, q->tag);
+    } else if (node->isType(ExprType::T_LOOKAHEAD)) {
+        k += static_cast<Lookahead*>(node)->negative ? "?!" : "?=";
+    } else if (node->isType(ExprType::T_LOOKBEHIND)) {
+        k += static_cast<Lookbehind*>(node)->negative ? "?<!" : "?<=";
+    } else if (!node->isType(ExprType::T_SEQUENCE) && !node->isType(ExprType::T_OR)) {
+        // leaves
+        k += ":" + node->str(false);
+    }
+    for (auto sub : *p->get_child()) {
+        k += "," + std::to_string(sub->get_key());
+    }
+    return k;
+}
+
+std::unique_ptr<RootBox> expr_to_box(ExprNode* expr, bool shared, RenderCache* shared_cache) {
     assert(expr);
 
     std::stack<std::pair<int,GraphBox*>> stk;
+    RenderCache local;
+    RenderCache& cache = shared_cache ? *shared_cache : local;
 
     int level = 0;
     expr->travel([&level](ExprNode* node) {
@@ -387,6 +418,8 @@ std::unique_ptr<RootBox> expr_to_box(ExprNode* expr) {
 
         if (p) {
             p->set_expr(node);
+            auto id = cache.ids.emplace(structure_key(node, p), cache.ids.size() + 1);
+            p->set_key(id.first->second);
             stk.emplace(level, p);
             // DEBUG_OS << "push: " << level << " " << p << " " << (node? node->str():"null") << "\n";
         }
@@ -408,10 +441,13 @@ std::unique_ptr<RootBox> expr_to_box(ExprNode* expr) {
 
     reset_color();
 
+    GraphBox::cache = shared ? &cache : nullptr;
     root->render();
+    GraphBox::cache = nullptr;
     // root->layout();
     return std::unique_ptr<RootBox>(root);
 };
 
+thread_local RenderCache* GraphBox::cache = nullptr;
 bool GraphBox::color = false;
 bool GraphBox::utf8_encoding = false;
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <stack>
+#include <unordered_map>
+#include <map>
 #include "utils.h"
 #include "Parser.h"
 #include "unicode.h"
@@ -244,6 +246,18 @@ std::pair<Rows,Span> box_special(const Rows& lines, const std::string& tag="", c
     return box_ext(TableId::DOUBLE, lines, tag, q);
 }
 
+// rendered rows of the distinct subtrees of one expression
+struct RenderCache {
+    struct Rendered {
+        Rows rows;
+        std::string raw;
+        int color_end;  // color index after the rendering
+    };
+    std::unordered_map<std::string,size_t> ids;   // structure -> id, ids start at 1
+    std::map<std::pair<size_t,int>,Rendered> rendered;  // id, color index at start -> rendering
+    size_t hits = 0;    // renderings copied instead of rendered
+};
+
 enum class BoxType {
     NORMAL,
     RANGE,
@@ -337,6 +351,34 @@ public:
         quant->str = pack_color(quant->str);
     }
 
+    void set_key(size_t key) {
+        this->key = key;
+    }
+
+    size_t get_key() {
+        return key;
+    }
+
+    // render, or copy the rows of an identical subtree rendered before.
+    // colors follow the render order, so a rendering is shared only from the same color
+    void render_shared() {
+        if (!cache || !key || quant) {
+            render();
+            return;
+        }
+        std::pair<size_t,int> k(key, color_index());
+        auto it = cache->rendered.find(k);
+        if (it != cache->rendered.end()) {
+            rows = it->second.rows;
+            raw = it->second.raw;
+            set_color_index(it->second.color_end);
+            cache->hits++;
+            return;
+        }
+        render();
+        cache->rendered[k] = {rows, raw, color_index()};
+    }
+
     void set_position(size_t x, size_t y) {
         this->x = x;
         this->y = y;
@@ -360,8 +402,13 @@ protected:
     // Span span;
     size_t x = 0;
     size_t y = 0;
+    size_t key = 0;     // structural id of the subtree, 0 if not shared
     static bool color;
     static bool utf8_encoding;
+
+public:
+    // cache of the expr_to_box running in this thread, null if rendering is not shared
+    static thread_local RenderCache* cache;
 };
 
 static inline std::string unescape(const std::string& s) {
@@ -502,7 +549,7 @@ public:
 
     void render() {
         auto tp = pack_color(top);
-        child.front()->render();
+        child.front()->render_shared();
         const Rows& rows = child.front()->get_rows();
         auto t = box_group(rows, tp, quant.get());
         this->rows = t.first;
@@ -538,7 +585,7 @@ public:
             DEBUG_OS << "Not implement for " << tag << "\n";
         }
         auto tp = pack_color(top);
-        child.front()->render();
+        child.front()->render_shared();
         const Rows& rows = child.front()->get_rows();
         auto t = box_group(rows, tp);
         this->rows = t.first;
@@ -582,7 +629,7 @@ public:
         size_t width = 0;
         size_t height = 0;
         for (auto branch : child) {
-            branch->render();
+            branch->render_shared();
             width = std::max(width, branch->get_width());
             height += branch->get_height();
         }
@@ -656,7 +703,7 @@ public:
         Quantifier* q = static_cast<Quantifier*>(expr);
 
         child.front()->set_quantifier(q);
-        child.front()->render();
+        child.front()->render_shared();
         this->rows = child.front()->get_rows();
         // this->span = {0};
     }
@@ -678,7 +725,7 @@ public:
     void render() {
         size_t height = 0;
         for (auto item : child) {
-            item->render();
+            item->render_shared();
             height = std::max(height, item->get_height());
         }
 
@@ -829,7 +876,7 @@ public:
 
     void render() {
         auto p = child.front();
-        p->render();
+        p->render_shared();
 
         size_t w = p->get_width();
         w += 2;
@@ -857,7 +904,9 @@ public:
     // }
 };
 
-std::unique_ptr<RootBox> expr_to_box(ExprNode* root);
+// boxes of the expression tree, identical subtrees share one rendering through cache,
+// a local one if null. Every subtree is rendered when shared is false
+std::unique_ptr<RootBox> expr_to_box(ExprNode* root, bool shared=true, RenderCache* cache=nullptr);
 
 static inline void travel_box(GraphBox* box, std::function<void(GraphBox*)> func) {
     std::stack<GraphBox*> stk;
@@ -5,6 +5,12 @@
 #include "GraphSvg.h"
 #include "http.h"
 #include "base64.h"
+#include "LruCache.h"
+
+// rendered /regex replies kept by the server
+#define RESPONSE_CACHE_SIZE 1024
+// larger replies are rebuilt each time instead of crowding the cache
+#define RESPONSE_CACHE_MAX_BODY (1024 * 1024)
 
 static inline const char* index_html = R"(
 <!DOCTYPE html>
@@ -338,9 +344,12 @@ static inline const char* index_html = R"(
 class GraphHttp {
 private:
     Http http;
+    // json reply of /regex by options and normalized expression
+    LruCache<std::string,std::string> cache;
 
 public:
-    GraphHttp(int port): http(port) {
+    GraphHttp(int port, int backlog=SOMAXCONN, size_t workers=0): http(port, backlog, workers),
+        cache(RESPONSE_CACHE_SIZE) {
         GraphBox::set_encoding(true);
         GraphBox::set_color(true);
     }
@@ -359,6 +368,10 @@ public:
             return handleRegex(req, true);
         });
 
+        http.Route("/stats", [this](const HttpRequest& req){
+            return handleStats(req);
+        });
+
         http.Start();
     }
 
@@ -371,6 +384,17 @@ private:
         return resp;
     }
 
+    HttpResponse handleStats(const HttpRequest& req) {
+        HttpResponse resp;
+        resp.status_code = 200;
+        resp.content_type = "application/json";
+        resp.body = "{\"cache\":{\"hits\":" + std::to_string(cache.hits())
+            + ",\"misses\":" + std::to_string(cache.misses())
+            + ",\"size\":" + std::to_string(cache.size())
+            + ",\"capacity\":" + std::to_string(RESPONSE_CACHE_SIZE) + "}}";
+        return resp;
+    }
+
     HttpResponse handleRegex(const HttpRequest& req, bool random=false) {
         HttpResponse resp;
         resp.status_code = 0;
@@ -389,10 +413,17 @@ private:
         std::string data;
         std::string msg;
         int code = 0;
+        std::string key;
 
         try {
             std::unique_ptr<ExprRoot> root(regex_parse(expr));
             if (root) {
+                // the rendering options are fixed by the server, the expression is normalized
+                key = "utf8,color:" + root->stringify(false);
+                if (cache.get(key, resp.body)) {
+                    DEBUG_OS << "Cached: " << key << "\n";
+                    return resp;
+                }
                 std::unique_ptr<RootBox> box(expr_to_box(root.get()));
                 std::string expr_str = root->stringify(true);
                 DEBUG_OS << "Parsed: " << expr_str << "\n";
@@ -433,6 +464,9 @@ private:
             << "}";
 
         resp.body = ss.str();
+        if (code == 0 && !key.empty() && resp.body.size() <= RESPONSE_CACHE_MAX_BODY) {
+            cache.put(key, resp.body);
+        }
 
         return resp;
     }
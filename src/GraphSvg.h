@@ -34,22 +34,17 @@ static inline void parse_line(std::vector<std::string>&res, const std::string& l
 
 class GraphSvg {
     std::string expr;
-    std::vector<std::vector<std::string>> rows;
-    std::string svg;
+    const std::vector<std::string>& graph;
     size_t graph_width;
 
 public:
-    GraphSvg(const std::string& expr, const std::vector<std::string>& graph): expr(expr) {
-        for (const std::string &row : graph) {
-            rows.push_back({});
-            parse_line(rows.back(), row);
-        }
+    // graph must outlive the writer, its rows are parsed one at a time while dumping
+    GraphSvg(const std::string& expr, const std::vector<std::string>& graph): expr(expr), graph(graph) {
         graph_width = visual_width(graph[0]);
-        render();
     }
 
     void dump(std::ostream& os) {
-        os << svg;
+        render(os);
     }
 
 private:
@@ -122,20 +117,29 @@ private:
         return {expr_y + FONT_SIZE, max_x};
     }
 
-    void render() {
+    // x advance of a parsed line, as render_line() moves it
+    static size_t line_width(const std::vector<std::string>& line) {
+        size_t w = 0;
+        for (const std::string& s : line) {
+            if (s[0] != ESC_PRE) w += visual_width(s);
+        }
+        return w * FONT_WIDTH;
+    }
+
+    void render(std::ostream& os) {
         std::stringstream expr_ss;
         auto [graph_y, expr_w] = render_expr(expr_ss);
 
-        std::stringstream graph_ss;
+        // the header needs the size, measure the rows before writing them
+        std::vector<std::string> line;
         size_t max_x = expr_w;
-        size_t y = graph_y;
-        for (auto& line : rows) {
-            size_t x = render_line(graph_ss, line, y, FONT_WIDTH);
-            y += FONT_SIZE;
-            max_x = std::max(max_x, x);
+        for (const std::string& row : graph) {
+            line.clear();
+            parse_line(line, row);
+            max_x = std::max(max_x, FONT_WIDTH + line_width(line));
         }
 
-        size_t height = y;
+        size_t height = graph_y + graph.size() * FONT_SIZE;
         size_t width = max_x + FONT_WIDTH;
 
         std::string background = "#fafafa";
@@ -149,20 +153,19 @@ private:
             foreground = dark_fg;
         }
 
-        std::stringstream ss;
-        ss << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        os << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
            << "<svg id=\"regexsvg\" width=" << strwraperr(width)
            << " height=" << strwraperr(height)
            << " fill=" << strwraperr(foreground)
            << " xmlns=" << "\"http://www.w3.org/2000/svg\"" << ">\n";
 
-        ss << "<rect id=\"svgbg\" x=\"0\" y=\"0\" width=\"100%\" height=\"100%\""
+        os << "<rect id=\"svgbg\" x=\"0\" y=\"0\" width=\"100%\" height=\"100%\""
            << " fill=" << strwraperr(background)
            << "/>";
 
-        ss << expr_ss.str();
+        os << expr_ss.str();
 
-        ss << "<text x=" << strwraperr(0)
+        os << "<text x=" << strwraperr(0)
            << " y=" << strwraperr(graph_y)
            << " font-size=" << strwraperr(FONT_SIZE)
            << " font-family=\"Consolas, Monaco, 'Courier New', monospace\""
@@ -170,15 +173,30 @@ private:
            << " text-anchor=\"start\""
            << " white-space=\"pre\">\n";
 
-        ss << graph_ss.str();
+        size_t y = graph_y;
+        for (const std::string& row : graph) {
+            line.clear();
+            parse_line(line, row);
+            render_line(os, line, y, FONT_WIDTH);
+            y += FONT_SIZE;
+        }
 
-        ss << "</text>" << "</svg>\n";
-        svg = ss.str();
+        os << "</text>" << "</svg>\n";
     }
 
+    // adjacent glyphs with the same style and width, drawn by one <tspan>
+    struct Run {
+        std::string text;
+        std::string color;
+        bool underline = false;
+        size_t x = 0;       // left of the first glyph
+        size_t end = 0;     // right of the last glyph
+        size_t width = 0;   // cells of each glyph
+        size_t count = 0;   // glyphs with a width
+    };
+
     size_t render_line(std::ostream& os, const std::vector<std::string>& line, size_t y, size_t x = 0) {
-        auto escape = [](std::string s) {
-            std::string res;
+        auto escape = [](const std::string& s, std::string& res) {
             for (char c : s) {
                 switch (c) {
                 case '<':
@@ -191,82 +209,71 @@ private:
                     res += c;
                 }
             }
-            return res;
-        };
-
-        size_t n = line.size();
-        size_t i = 0;
-        size_t x_space = FONT_WIDTH;
-        auto is_esc = [](const std::string& s) {
-            return s[0] == ESC_PRE;
         };
 
-        while (i < n) {
-            size_t k = i;
-            while (k < n && line[k] == " ") {
-                k++;
+        Run run;
+        bool first = true;
+        std::string color;
+        bool underline = false;
+        for (const std::string& s : line) {
+            if (s[0] == ESC_PRE) {
+                if (s == NC) {
+                    color.clear();
+                    underline = false;
+                } else if (s == UNDERLINE) {
+                    underline = true;
+                } else {
+                    // a second color opens a new span without the underline
+                    if (!color.empty()) underline = false;
+                    color = esc_code_color(s);
+                }
+                continue;
             }
-            if (k > i) {
-                x += (k-i) * x_space;
-                i = k;
-                if (i >= n) break;
+            // spaces only move the pen, they split runs
+            if (s == " ") {
+                x += FONT_WIDTH;
+                continue;
             }
-
-            std::vector<std::string> ws;
-
-            std::string color;
-            bool underline = false;
-            size_t j = i;
-            std::string text;
-
-            if (is_esc(line[j])) {
-                while (j < n && line[j] != NC) {
-                    if (is_esc(line[j])) {
-                        if (line[j] == UNDERLINE) {
-                            underline = true;
-                        } else {
-                            if (!color.empty()) {
-                                j--;
-                                break;
-                            }
-                            color = esc_code_color(line[j]);
-                        }
-                    } else {
-                        ws.push_back(std::to_string(x));
-                        x += visual_width(line[j]) * x_space;
-                        text += escape(line[j]);
-                    }
-                    j++;
-                }
-                j++; // NC
-            } else {
-                while (j < n && line[j] != " " && !is_esc(line[j])) {
-                    ws.push_back(std::to_string(x));
-                    x += visual_width(line[j]) * x_space;
-                    text += escape(line[j]);
-                    j++;
-                }
+            size_t w = visual_width(s);
+            if (run.text.empty() || run.color != color || run.underline != underline
+                || (w > 0 && (run.end != x || run.width != w))) {
+                tspan(os, run, y, first);
+                run.text.clear();
+                run.color = color;
+                run.underline = underline;
+                run.x = x;
+                run.width = w;
+                run.count = 0;
             }
-
-            auto xs =  Utils::concat(ws, " ");
-            tspan(os, text, xs, y, color, underline);
-
-            i = j;
+            escape(s, run.text);
+            if (w > 0) run.count++;
+            x += w * FONT_WIDTH;
+            run.end = x;
         }
+        tspan(os, run, y, first);
         return x;
     }
 
-    void tspan(std::ostream& os, const std::string& content
-        , const std::string& xs, size_t y, const std::string& fill="", bool underline=false) {
-        os << "<tspan " << "y=" << strwraperr(y);
-        os << " x=" << strwraperr(xs);
-        if (!fill.empty()) {
-           os << " fill=" << strwraperr(fill);
+    // runs of several glyphs are stretched to the cell grid with textLength,
+    // later runs of a line keep the y of the first one
+    void tspan(std::ostream& os, const Run& run, size_t y, bool& first) {
+        if (run.text.empty()) return;
+        os << "<tspan";
+        if (first) {
+            os << " y=" << strwraperr(y);
+            first = false;
+        }
+        os << " x=" << strwraperr(run.x);
+        if (run.count > 1) {
+            os << " textLength=" << strwraperr(run.end - run.x);
+        }
+        if (!run.color.empty()) {
+           os << " fill=" << strwraperr(run.color);
         }
-        if (underline) {
+        if (run.underline) {
             os << " text-decoration=\"underline\"";
         }
-        os << ">" << content << "</tspan>\n";
+        os << ">" << run.text << "</tspan>\n";
     }
 };
 
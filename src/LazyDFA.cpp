@@ -0,0 +1,194 @@
+#include "LazyDFA.h"
+
+// a flush is worth it only if this many bytes per cached state were scanned since the last one
+#define MIN_BYTES_PER_STATE 10
+
+LazyDFA::LazyDFA(NFA* nfa, size_t cache_size): nfa(nfa), cache_size(cache_size),
+    scanned(0), n_flushes(0), n_fallbacks(0), fallback(false) {
+    assert(nfa);
+    alphabet = nfa->byte_classes(classes);
+    prefilter = Prefilter(nfa->literals);
+    // set words, transition row, flag and the hash map entry
+    size_t words = (nfa->states() + 63) / 64;
+    state_size = 2 * words * sizeof(uint64_t) + alphabet * sizeof(uint32_t) + 1 + 4 * sizeof(void*);
+    flush();
+    n_flushes = 0;
+}
+
+size_t LazyDFA::states() const {
+    return sets.size();
+}
+
+size_t LazyDFA::flushes() const {
+    return n_flushes;
+}
+
+size_t LazyDFA::fallbacks() const {
+    return n_fallbacks;
+}
+
+void LazyDFA::flush() {
+    sets.clear();
+    trans.clear();
+    flags.clear();
+    ids.clear();
+    initial[0] = initial[1] = UNKNOWN;
+    n_flushes++;
+    scanned = 0;
+    // dead state
+    add_state(Bits(nfa->states()));
+    std::fill(trans.begin(), trans.end(), DEAD_STATE);
+}
+
+uint8_t LazyDFA::accept_flags(const Bits& b) {
+    uint8_t f = 0;
+    if (b.test(nfa->state_final)) f |= DFATable::ACCEPT;
+    Bits e = b;
+    nfa->closure(e, TOK_EOL);
+    if (e.test(nfa->state_final)) f |= DFATable::ACCEPT_EOT;
+    return f;
+}
+
+uint32_t LazyDFA::add_state(Bits&& b) {
+    auto it = ids.find(b);
+    if (it != ids.end()) return it->second;
+    uint32_t s = sets.size();
+    flags.push_back(accept_flags(b));
+    trans.resize(trans.size() + alphabet, UNKNOWN);
+    ids.emplace(b, s);
+    sets.push_back(std::move(b));
+    return s;
+}
+
+uint32_t LazyDFA::start(bool bot) {
+    uint32_t& s = initial[bot];
+    if (s == UNKNOWN) {
+        Bits b(nfa->states());
+        b.set(nfa->state_initial);
+        nfa->closure(b, bot ? TOK_BOL : TOK_EPSILON);
+        s = add_state(std::move(b));
+    }
+    return s;
+}
+
+// transition of s on a byte class, s is renumbered if the cache is flushed
+uint32_t LazyDFA::next(uint32_t& s, uint16_t cls) {
+    uint32_t t = trans[s * alphabet + cls];
+    if (t != UNKNOWN) return t;
+    if (cls == 0) {
+        return trans[s * alphabet] = DEAD_STATE;
+    }
+
+    Bits b = nfa->move(sets[s], cls + TOK_CLASS - 1);
+    if (!ids.count(b) && (sets.size() + 1) * state_size > cache_size) {
+        if (scanned < sets.size() * MIN_BYTES_PER_STATE) {
+            // thrashing, leave the rest of this scan to the nfa
+            fallback = true;
+            return UNKNOWN;
+        }
+        Bits cur = sets[s];
+        flush();
+        s = add_state(std::move(cur));
+    }
+    t = add_state(std::move(b));
+    trans[s * alphabet + cls] = t;
+    return t;
+}
+
+// NFA simulation from the state set cur at pos, end is the last match found
+size_t LazyDFA::simulate(Bits cur, std::string_view text, size_t pos, size_t end) {
+    n_fallbacks++;
+    for (size_t i = pos; i < text.size(); i++) {
+        uint16_t cls = classes[(unsigned char)text[i]];
+        if (cls == 0) return end;
+        cur = nfa->move(cur, cls + TOK_CLASS - 1);
+        if (cur.empty()) return end;
+        if (cur.test(nfa->state_final)) end = i + 1;
+    }
+    if (accept_flags(cur) & DFATable::ACCEPT_EOT) end = text.size();
+    return end;
+}
+
+// end of the longest match starting at pos, NO_MATCH if none
+size_t LazyDFA::longest(std::string_view text, size_t pos) {
+    const size_t n = text.size();
+    fallback = false;
+
+    uint32_t s = start(pos == 0);
+    size_t end = NO_MATCH;
+    if ((flags[s] & DFATable::ACCEPT) || (pos == n && (flags[s] & DFATable::ACCEPT_EOT))) {
+        end = pos;
+    }
+    for (size_t i = pos; i < n; i++) {
+        uint16_t cls = classes[(unsigned char)text[i]];
+        uint32_t t = trans[s * alphabet + cls];
+        if (t == UNKNOWN) {
+            t = next(s, cls);
+            if (fallback) {
+                return simulate(sets[s], text, i, end);
+            }
+        }
+        scanned++;
+        if (t == DEAD_STATE) return end;
+        s = t;
+        if (flags[s] & DFATable::ACCEPT) end = i + 1;
+    }
+    if (flags[s] & DFATable::ACCEPT_EOT) end = n;
+    return end;
+}
+
+bool LazyDFA::match(std::string_view text) {
+    return longest(text, 0) == text.size();
+}
+
+size_t LazyDFA::leftmost(std::string_view text, size_t pos, std::vector<bool>* marks) {
+    if (!rev) {
+        rnfa = std::make_unique<NFA>(nfa->reverse());
+        rev = std::make_unique<LazyDFA>(rnfa.get(), cache_size);
+    }
+    auto scan = [&](size_t from, size_t to) {
+        return rev->scan_back(text, from, to, marks);
+    };
+    if (marks) return scan(pos, text.size());
+    return leftmost_in_windows(text.size(), pos, nfa->max_length(), scan);
+}
+
+// run as the reversed automaton: scan text backward from to down to pos, the smallest
+// accepting position is the leftmost start of the matches ending at or before to
+size_t LazyDFA::scan_back(std::string_view text, size_t pos, size_t to, std::vector<bool>* marks) {
+    fallback = false;
+    size_t first = NO_MATCH;
+    auto accept = [&](uint8_t f, size_t i) {
+        if ((f & DFATable::ACCEPT) || (i == 0 && (f & DFATable::ACCEPT_EOT))) {
+            first = i;
+            if (marks) (*marks)[i] = true;
+        }
+    };
+
+    uint32_t s = start(to == text.size());
+    accept(flags[s], to);
+    for (size_t i = to; i > pos; i--) {
+        uint16_t cls = classes[(unsigned char)text[i-1]];
+        uint32_t t = trans[s * alphabet + cls];
+        if (t == UNKNOWN) {
+            t = next(s, cls);
+            if (fallback) {
+                n_fallbacks++;
+                Bits cur = sets[s];
+                for (; i > pos; i--) {
+                    cls = classes[(unsigned char)text[i-1]];
+                    if (cls == 0) break;
+                    cur = nfa->move(cur, cls + TOK_CLASS - 1);
+                    if (cur.empty()) break;
+                    accept(accept_flags(cur), i-1);
+                }
+                return first;
+            }
+        }
+        scanned++;
+        if (t == DEAD_STATE) break;
+        s = t;
+        accept(flags[s], i-1);
+    }
+    return first;
+}
@@ -0,0 +1,52 @@
+#ifndef __LAZY_DFA_H__
+#define __LAZY_DFA_H__
+
+#include "DFA.h"
+
+// DFA determinized on demand while scanning, states are cached within a memory budget.
+// When the cache is full it is flushed, and if flushes come too often the scan falls
+// back to NFA simulation, so the cost follows the input instead of the pattern size.
+class LazyDFA: public LongestMatcher {
+public:
+    LazyDFA(NFA* nfa, size_t cache_size = 1 << 20);
+
+    // same semantics as DFA: whole text, leftmost-longest, non-overlapping
+    bool match(std::string_view text);
+
+    size_t states() const;  // states in the cache now
+    size_t flushes() const; // cache flushes so far
+    size_t fallbacks() const;  // scans finished by NFA simulation
+
+private:
+    uint32_t add_state(Bits&& b);
+    uint32_t start(bool bot);
+    uint32_t next(uint32_t& s, uint16_t cls);
+    void flush();
+    uint8_t accept_flags(const Bits& b);
+    size_t leftmost(std::string_view text, size_t pos, std::vector<bool>* marks);
+    size_t longest(std::string_view text, size_t pos);
+    size_t scan_back(std::string_view text, size_t pos, size_t to, std::vector<bool>* marks);
+    size_t simulate(Bits cur, std::string_view text, size_t pos, size_t end);
+
+private:
+    static constexpr uint32_t UNKNOWN = UINT32_MAX;
+
+    NFA* nfa;
+    size_t cache_size;
+    size_t state_size;                  // approximate bytes of a cached state
+    uint32_t alphabet;                  // byte classes, 0 is dead
+    uint16_t classes[256];              // byte -> class
+    std::vector<Bits> sets;             // state -> nfa states, 0 is dead
+    std::vector<uint32_t> trans;        // [state * alphabet + class] -> state or UNKNOWN
+    std::vector<uint8_t> flags;         // DFATable::Flag of each state
+    std::unordered_map<Bits,uint32_t,Bits::Hash> ids;
+    uint32_t initial[2];                // inside the text, at the beginning of text
+    size_t scanned;                     // bytes scanned since the last flush
+    size_t n_flushes;
+    size_t n_fallbacks;
+    bool fallback;                      // cache thrashing, simulate the current scan
+    std::unique_ptr<NFA> rnfa;          // reversed automaton for match starts
+    std::unique_ptr<LazyDFA> rev;
+};
+
+#endif // __LAZY_DFA_H__
@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cstring>
+#include "Literals.h"
+#include "AhoCorasick.h"
+
+// larger prefix sets are scanned with Aho-Corasick
+#define MAX_TABLE_PREFIXES 16
+
+// how common a byte is in text, letters by their frequency in English
+static int byte_rank(unsigned char c) {
+    static const char letters[] = "etaoinshrdlcumwfgypbvkjxqz";
+    if (c == ' ') return 255;
+    if (c >= 'a' && c <= 'z') return 230 - 5 * (strchr(letters, c) - letters);
+    if (c >= 'A' && c <= 'Z') return 100 - 2 * (strchr(letters, c | 0x20) - letters);
+    if (c == '\n') return 150;
+    if (c >= '0' && c <= '9') return 110;
+    if (c && strchr(".,-_/:=\"'", c)) return 90;
+    if (c > ' ' && c < 0x7F) return 50;
+    return 40;
+}
+
+// index of the rarest byte of lit, the one memchr looks for
+static size_t rare_index(const std::string& lit) {
+    size_t r = 0;
+    for (size_t i = 1; i < lit.size(); i++) {
+        if (byte_rank(lit[i]) < byte_rank(lit[r])) r = i;
+    }
+    return r;
+}
+
+// first occurrence of lit at or after pos, npos if none
+static size_t find(std::string_view text, size_t pos, const std::string& lit, size_t rare) {
+    const char* s = text.data();
+    const size_t n = text.size();
+    for (size_t i = pos + rare; i < n; i++) {
+        const char* p = (const char*)memchr(s + i, lit[rare], n - i);
+        if (!p) break;
+        i = p - s;
+        if (i - rare + lit.size() > n) break;
+        if (memcmp(s + i - rare, lit.data(), lit.size()) == 0) return i - rare;
+    }
+    return std::string_view::npos;
+}
+
+Prefilter::Prefilter(const Literals& lits): required(lits.inner), prefixes(lits.prefixes) {
+    required_rare = rare_index(required);
+    // an occurrence of "ab" is found before the one of "abc" at the same place
+    std::sort(prefixes.begin(), prefixes.end());
+    size_t k = 0;
+    for (size_t i = 0; i < prefixes.size(); i++) {
+        if (k && prefixes[i].compare(0, prefixes[k-1].size(), prefixes[k-1]) == 0) continue;
+        prefixes[k++] = prefixes[i];
+    }
+    prefixes.resize(k);
+    for (auto& p : prefixes) {
+        if (!first[(unsigned char)p[0]]) nfirst++;
+        first[(unsigned char)p[0]] = true;
+    }
+    if (prefixes.size() == 1) prefix_rare = rare_index(prefixes[0]);
+    if (prefixes.size() > MAX_TABLE_PREFIXES) ac = std::make_shared<AhoCorasick>(prefixes);
+}
+
+bool Prefilter::possible(std::string_view text, size_t pos) const {
+    return required.empty() || find(text, pos, required, required_rare) != std::string_view::npos;
+}
+
+size_t Prefilter::candidate(std::string_view text, size_t pos) const {
+    if (prefixes.empty()) return pos;
+    if (prefixes.size() == 1) return find(text, pos, prefixes[0], prefix_rare);
+    if (ac) return ac->first(text, pos);
+
+    const unsigned char* s = (const unsigned char*)text.data();
+    const size_t n = text.size();
+    for (size_t i = pos; i < n; i++) {
+        if (nfirst == 1) {
+            const void* p = memchr(s + i, prefixes[0][0], n - i);
+            if (!p) break;
+            i = (const unsigned char*)p - s;
+        } else {
+            while (i < n && !first[s[i]]) i++;
+            if (i == n) break;
+        }
+        for (auto& p : prefixes) {
+            if (text.compare(i, p.size(), p) == 0) return i;
+        }
+    }
+    return std::string_view::npos;
+}
@@ -0,0 +1,51 @@
+#ifndef __LITERALS_H__
+#define __LITERALS_H__
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// literals every match of an expression contains, extracted by NFA::generate
+struct Literals {
+    std::vector<std::string> prefixes;  // each match starts with one of them, empty if unknown
+    std::vector<std::string> suffixes;  // each match ends with one of them, empty if unknown
+    std::string inner;                  // occurs in every match, empty if none
+    std::vector<std::string> words;     // all matches of an alternation of literals, else empty
+
+    bool empty() const {
+        return prefixes.empty() && suffixes.empty() && inner.empty();
+    }
+};
+
+class AhoCorasick;
+
+// skips the text which can't hold a match before an automaton is run on it, with memchr
+// on the rarest byte of a literal, a byte table for a few prefixes and Aho-Corasick for more
+class Prefilter {
+public:
+    Prefilter() = default;
+    Prefilter(const Literals& lits);
+
+    // a match can start at the candidates only
+    bool has_prefixes() const {
+        return !prefixes.empty();
+    }
+
+    // text from pos contains the literal every match has
+    bool possible(std::string_view text, size_t pos) const;
+    // first position at or after pos where a prefix occurs, npos if none.
+    // pos itself without prefixes
+    size_t candidate(std::string_view text, size_t pos) const;
+
+private:
+    std::string required;               // longest literal of every match
+    std::vector<std::string> prefixes;  // none is a prefix of another
+    bool first[256] = {false};          // first bytes of the prefixes
+    int nfirst = 0;
+    size_t required_rare = 0;           // index of the byte memchr looks for
+    size_t prefix_rare = 0;
+    std::shared_ptr<const AhoCorasick> ac;  // for many prefixes
+};
+
+#endif // __LITERALS_H__
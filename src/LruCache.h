@@ -0,0 +1,76 @@
+#ifndef __LRU_CACHE_H__
+#define __LRU_CACHE_H__
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+// bounded least-recently-used map, safe to share between threads
+template<typename K, typename V>
+class LruCache {
+public:
+    LruCache(size_t capacity): capacity(capacity) {
+    }
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    // copy the value of key to v and mark it as used
+    bool get(const K& key, V& v) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            n_misses++;
+            return false;
+        }
+        items.splice(items.begin(), items, it->second);
+        v = it->second->second;
+        n_hits++;
+        return true;
+    }
+
+    // insert or replace, the least recently used entry is evicted when full
+    void put(const K& key, V v) {
+        if (capacity == 0) return;
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->second->second = std::move(v);
+            items.splice(items.begin(), items, it->second);
+            return;
+        }
+        if (items.size() >= capacity) {
+            index.erase(items.back().first);
+            items.pop_back();
+        }
+        items.emplace_front(key, std::move(v));
+        index.emplace(key, items.begin());
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return items.size();
+    }
+
+    size_t hits() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return n_hits;
+    }
+
+    size_t misses() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return n_misses;
+    }
+
+private:
+    using Item = std::pair<K,V>;
+
+    size_t capacity;
+    std::list<Item> items;  // most recently used first
+    std::unordered_map<K,typename std::list<Item>::iterator> index;
+    size_t n_hits = 0;
+    size_t n_misses = 0;
+    std::mutex mtx;
+};
+
+#endif // __LRU_CACHE_H__
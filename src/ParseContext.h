@@ -0,0 +1,50 @@
+#ifndef __PARSE_CONTEXT_H__
+#define __PARSE_CONTEXT_H__
+
+#if !defined(yyFlexLexerOnce)
+#include <FlexLexer.h>
+#endif
+
+#include <sstream>
+#include "Parser.h"
+#include "y.tab.hh"
+
+struct ParseContext;
+
+// flex scanner bound to one parse, semantic value and location are passed in by bison
+class Lexer: public yyFlexLexer {
+public:
+    Lexer(std::istream* in, ParseContext* ctx): yyFlexLexer(in), ctx(ctx) {
+    }
+
+    int yylex(YYSTYPE* yylval, YYLTYPE* yylloc);
+    using yyFlexLexer::yylex;
+
+private:
+    ParseContext* ctx;
+};
+
+// all state of one regex_parse call, nothing is shared between threads
+struct ParseContext {
+    std::string text;
+    std::istringstream iss;
+    Lexer lexer;
+    std::unique_ptr<Arena> arena;
+    Arena::Scope scope;
+    ExprRoot* expr = nullptr;       // set by the root rule
+    const char* yytext = nullptr;   // text of the last token
+    YYLTYPE loc = {0, 0, 0, 0};     // location of the last token
+    std::vector<void*> allocs;      // bison stack, leaked if an action throws
+    bool verbose = true;            // print errors to stderr
+
+    ParseContext(const std::string& text);
+    ~ParseContext();
+
+    // context of the parse running in this thread
+    static thread_local ParseContext* current;
+
+private:
+    ParseContext* prev;
+};
+
+#endif // __PARSE_CONTEXT_H__
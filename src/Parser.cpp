@@ -2,12 +2,12 @@
 
 extern void yyerror_throw(const std::string& msg);
 
-int ExprNode::indent_ = 0;
-int ExprNode::depth_ = 0;
-std::unordered_set<void*> ExprNode::allocs_;
+thread_local int ExprNode::indent_ = 0;
+thread_local int ExprNode::depth_ = 0;
+thread_local Arena* Arena::current = nullptr;
 
 static std::vector<std::string> colors = {GREEN, BLUE, YELLOW, PURPLE, RED, CYAN};
-static int color_idx = 0;
+static thread_local int color_idx = 0;
 
 void reset_color() {
     color_idx = 0;
@@ -18,6 +18,14 @@ std::string iter_color() {
     return colors[color_idx++];
 }
 
+int color_index() {
+    return color_idx % colors.size();
+}
+
+void set_color_index(int i) {
+    color_idx = i;
+}
+
 
 static inline std::pair<int,int> parse_quantifier(char ch) {
     switch (ch) {
@@ -98,46 +106,60 @@ std::string ExprNode::prefix() {
     }
 }
 
-void* ExprNode::operator new(std::size_t size) {
-    void* ptr = std::malloc(size);
-    if (!ptr) throw std::bad_alloc();
-    allocs_.insert(ptr);
-    return ptr;
+/* Arena */
+Arena::~Arena() {
+    for (auto it=objs.rbegin(); it!=objs.rend(); ++it) {
+        static_cast<ExprNode*>(*it)->~ExprNode();
+    }
 }
 
-void* ExprNode::operator new[](std::size_t size) {
-    void* ptr = std::malloc(size);
-    if (!ptr) throw std::bad_alloc();
-    allocs_.insert(ptr);
+void* Arena::alloc(size_t size) {
+    const size_t align = alignof(std::max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+    char* ptr;
+    if (size > CHUNK_SIZE) {
+        chunks.emplace_back(new char[size]);
+        ptr = chunks.back().get();
+    } else {
+        if (used + size > CHUNK_SIZE) {
+            chunks.emplace_back(new char[CHUNK_SIZE]);
+            head = chunks.back().get();
+            used = 0;
+        }
+        ptr = head + used;
+        used += size;
+    }
+    objs.push_back(ptr);
     return ptr;
 }
 
-void ExprNode::operator delete(void* ptr) noexcept {
-    if (allocs_.find(ptr) != allocs_.end()) {
-        allocs_.erase(ptr);
-        std::free(ptr);
+void Arena::forget(void* ptr) noexcept {
+    for (auto it=objs.rbegin(); it!=objs.rend(); ++it) {
+        if (*it == ptr) {
+            objs.erase(std::next(it).base());
+            return;
+        }
     }
 }
 
-void ExprNode::operator delete[](void* ptr) noexcept {
-    if (allocs_.find(ptr) != allocs_.end()) {
-        allocs_.erase(ptr);
-        std::free(ptr);
+void* ExprNode::operator new(std::size_t size) {
+    Arena* arena = Arena::current;
+    if (!arena) {
+        throw std::runtime_error("ExprNode allocated outside of a parse");
     }
+    return arena->alloc(size);
 }
 
-void ExprNode::destroy() noexcept {
-    for (auto ptr : allocs_) {
-        std::free(ptr);
-    }
-    allocs_.clear();
+void ExprNode::operator delete(void* ptr) noexcept {
+    // memory is released with the arena
+    if (Arena::current) Arena::current->forget(ptr);
 }
 
 /* ExprRoot */
 ExprRoot::ExprRoot(ExprNode* expr): ExprNode(ExprType::T_ROOT), expr(expr) { }
 
 ExprRoot::~ExprRoot() {
-    delete expr;
+    // nodes are released with the arena
 }
 
 std::string ExprRoot::str(bool color) {
@@ -219,7 +241,6 @@ Literal::~Literal() {
 void Literal::append(Literal* rhs) {
     escaped += rhs->escaped;
     chars += rhs->chars;
-    delete rhs;
 }
 
 std::string Literal::str(bool color) {
@@ -337,7 +358,6 @@ Quantifier::Quantifier(std::string s): ExprNode(ExprType::T_QUANTIFIER), val(s),
 }
 
 Quantifier::~Quantifier() {
-    if (prev) delete prev;
 }
 
 void Quantifier::attach(ExprNode* node) {
@@ -491,9 +511,6 @@ std::string Any::xml() {
 Sequence::Sequence(): ExprNode(ExprType::T_SEQUENCE) {}
 
 Sequence::~Sequence() {
-    for (auto p : nodes) {
-        delete p;
-    }
 }
 
 void Sequence::push(ExprNode* node) {
@@ -515,7 +532,6 @@ void Sequence::append(ExprNode* node) {
             push(p);
         }
         seq->nodes.clear();
-        delete seq;
     } else {
         push(node);
     }
@@ -566,7 +582,6 @@ Class::Class(ExprNode* seq, bool negative)
 : ExprNode(ExprType::T_CLASS), seq(seq), negative(negative) {}
 
 Class::~Class() {
-    if (seq) delete seq;
 }
 
 void Class::travel(TravelFunc preFn, TravelFunc postFn, bool postorder) {
@@ -611,7 +626,6 @@ Group::Group(ExprNode* expr, bool capture, const std::string& name)
 : ExprNode(ExprType::T_GROUP), expr(expr), capture(capture), id(0), name(name) {}
 
 Group::~Group() {
-    if (expr) delete expr;
 }
 
 void Group::travel(TravelFunc preFn, TravelFunc postFn, bool postorder) {
@@ -706,7 +720,6 @@ Lookahead::Lookahead(ExprNode* expr, bool negative)
 : ExprNode(ExprType::T_LOOKAHEAD), expr(expr), negative(negative) { }
 
 Lookahead::~Lookahead() {
-    if (expr) delete expr;
 }
 
 void Lookahead::travel(TravelFunc preFn, TravelFunc postFn, bool postorder) {
@@ -751,7 +764,6 @@ Lookbehind::Lookbehind(ExprNode* expr, bool negative)
 : ExprNode(ExprType::T_LOOKBEHIND), expr(expr), negative(negative) { }
 
 Lookbehind::~Lookbehind() {
-    if (expr) delete expr;
 }
 
 void Lookbehind::travel(TravelFunc preFn, TravelFunc postFn, bool postorder) {
@@ -797,9 +809,6 @@ Or::Or(ExprNode* left, ExprNode* right): ExprNode(ExprType::T_OR) {
 }
 
 Or::~Or() {
-    for (auto item : items) {
-        if (item) delete item;
-    }
 }
 
 void Or::appendLeft(ExprNode* node) {
@@ -817,7 +826,6 @@ void Or::append(ExprNode* node) {
             items.push_back(p->items[i]);
         }
         p->items.clear();
-        delete node;
         return;
     }
 
@@ -3,6 +3,7 @@
 
 #include <cassert>
 #include <memory>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <cstring>
@@ -108,6 +109,9 @@ static inline std::string exprTypeName(ExprType t) {
 
 void reset_color();
 std::string iter_color();
+// position of the color iterator, to replay a rendering
+int color_index();
+void set_color_index(int i);
 
 static inline std::string end_color() {
     return NC;
@@ -119,6 +123,48 @@ static inline std::string iter_color_pack(const std::string s) {
 
 
 
+struct ExprNode;
+
+// chunked bump allocator owning all nodes of one parse,
+// nodes are destroyed and released together with the arena
+class Arena {
+public:
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena();
+
+    // memory for one node, destroyed with the arena
+    void* alloc(size_t size);
+    // node constructor threw, don't destroy it again
+    void forget(void* ptr) noexcept;
+
+    size_t nodes() const {
+        return objs.size();
+    }
+
+    // install an arena as the target of `new ExprNode` in this thread
+    struct Scope {
+        Arena* prev;
+        Scope(Arena* arena): prev(current) {
+            current = arena;
+        }
+        ~Scope() {
+            current = prev;
+        }
+    };
+
+    static thread_local Arena* current;
+
+private:
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char* head = nullptr;       // chunk being filled
+    size_t used = CHUNK_SIZE;
+    std::vector<void*> objs;    // allocated nodes, in allocation order
+};
+
 struct ExprNode {
     using TravelFunc = std::function<void(ExprNode*)>;
 
@@ -147,23 +193,30 @@ struct ExprNode {
     virtual std::string xml() = 0;
     virtual void travel(TravelFunc preFn=nullptr, TravelFunc postFn=nullptr, bool postorder=false) =0;
 
+    // nodes live in Arena::current, `delete` only drops a node whose constructor threw
     void* operator new(std::size_t size);
-    void* operator new[](std::size_t size);
     void operator delete(void* ptr) noexcept;
-    void operator delete[](void* ptr) noexcept;
-    static void destroy() noexcept;
 
-    static int indent_;
-    static int depth_;
-    static std::unordered_set<void*> allocs_;
+    // formatting state, per thread so trees can be printed concurrently
+    static thread_local int indent_;
+    static thread_local int depth_;
 };
 
 struct ExprRoot: ExprNode {
     ExprNode* expr;
+    std::unique_ptr<Arena> arena;   // owns expr and all its descendants
 
     ExprRoot(ExprNode* expr);
     ~ExprRoot();
 
+    // the root itself is heap allocated, it outlives its arena
+    void* operator new(std::size_t size) {
+        return ::operator new(size);
+    }
+    void operator delete(void* ptr) noexcept {
+        ::operator delete(ptr);
+    }
+
     std::string stringify(bool color=false);
     std::string format(int indent, bool color);
     std::string xml();
@@ -445,6 +498,7 @@ static inline std::string escape(const std::string& str) {
     return s;
 }
 
-extern std::unique_ptr<ExprRoot> regex_parse(const std::string& expr, bool debug=false);
+// verbose: also print the error with its position to stderr
+extern std::unique_ptr<ExprRoot> regex_parse(const std::string& expr, bool debug=false, bool verbose=true);
 
 #endif
\ No newline at end of file
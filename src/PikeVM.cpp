@@ -0,0 +1,141 @@
+#include "PikeVM.h"
+
+void PikeVM::Threads::init(size_t states, size_t nslots) {
+    dense.resize(states);
+    sparse.resize(states);
+    slots.resize(states * nslots);
+    size = 0;
+}
+
+bool PikeVM::Threads::contains(uint32_t s) const {
+    uint32_t i = sparse[s];
+    return i < size && dense[i] == s;
+}
+
+size_t PikeVM::Threads::insert(uint32_t s) {
+    sparse[s] = size;
+    dense[size] = s;
+    return size++;
+}
+
+PikeVM::PikeVM(NFA* nfa): nfa(nfa) {
+    assert(nfa);
+    nslots = 2 * nfa->group_names.size();
+    clist.init(nfa->states(), nslots);
+    nlist.init(nfa->states(), nslots);
+    scratch.assign(nslots, NO_MATCH);
+}
+
+size_t PikeVM::groups() const {
+    return nfa->group_names.size();
+}
+
+int PikeVM::group_index(const std::string& name) const {
+    for (size_t i = 1; i < nfa->group_names.size(); i++) {
+        if (nfa->group_names[i] == name) return i;
+    }
+    return -1;
+}
+
+// add s and the states its epsilon edges reach, in priority order
+void PikeVM::add_thread(Threads& l, State s0, size_t pos, std::string_view text, size_t* slots) {
+    stk.push_back({s0, -1, 0});
+    while (!stk.empty()) {
+        Frame f = stk.back();
+        stk.pop_back();
+        if (f.slot >= 0) {
+            // back from the states after a save
+            slots[f.slot] = f.old;
+            continue;
+        }
+        State s = f.state;
+        if (l.contains(s)) continue;
+
+        int save = nfa->saves[s];
+        if (save >= 0) {
+            stk.push_back({INVALID_STATE, save, slots[save]});
+            slots[save] = pos;
+        }
+        size_t i = l.insert(s);
+        std::copy(slots, slots + nslots, l.slots.begin() + i * nslots);
+
+        // pushed in reverse, so the first epsilon edge is tried first
+        for (uint32_t k = nfa->off[s]; k < nfa->off[s+1] && nfa->toks[k] < TOK_CLASS; k++) {
+            Token t = nfa->toks[k];
+            if ((t == TOK_EOL && pos == text.size()) || (t == TOK_BOL && pos == 0)) {
+                stk.push_back({nfa->targets[k], -1, 0});
+            }
+        }
+        for (uint32_t k = nfa->eps_off[s+1]; k > nfa->eps_off[s]; k--) {
+            stk.push_back({nfa->eps_targets[k-1], -1, 0});
+        }
+    }
+}
+
+bool PikeVM::run(std::string_view text, size_t pos, bool anchored, bool full, Captures& caps) {
+    const size_t n = text.size();
+    const State final = nfa->state_final;
+    bool found = false;
+    matched.assign(nslots, NO_MATCH);
+    clist.size = 0;
+
+    for (size_t i = pos; ; i++) {
+        if (!found && (i == pos || !anchored)) {
+            // a new thread at the lowest priority
+            std::fill(scratch.begin(), scratch.end(), NO_MATCH);
+            scratch[0] = i;
+            add_thread(clist, nfa->state_initial, i, text, scratch.data());
+        }
+        if (clist.size == 0) break;
+
+        nlist.size = 0;
+        Token tok = i < n ? nfa->byte_token[(unsigned char)text[i]] : INVALID_TOKEN;
+        for (size_t k = 0; k < clist.size; k++) {
+            State s = clist.dense[k];
+            size_t* slots = &clist.slots[k * nslots];
+            if (s == final) {
+                if (full && i != n) continue;
+                std::copy(slots, slots + nslots, matched.begin());
+                matched[1] = i;
+                found = true;
+                // the lower priority threads are cut off
+                break;
+            }
+            if (tok == INVALID_TOKEN) continue;
+            for (uint32_t e = nfa->off[s]; e < nfa->off[s+1]; e++) {
+                if (nfa->toks[e] == tok) add_thread(nlist, nfa->targets[e], i + 1, text, slots);
+            }
+        }
+        std::swap(clist, nlist);
+        if (i >= n) break;
+    }
+
+    if (!found) return false;
+    caps.groups.assign(nslots / 2, Match{NO_MATCH, NO_MATCH});
+    for (size_t g = 0; g < nslots / 2; g++) {
+        if (matched[2 * g] != NO_MATCH && matched[2 * g + 1] != NO_MATCH) {
+            caps.groups[g] = Match{matched[2 * g], matched[2 * g + 1]};
+        }
+    }
+    return true;
+}
+
+bool PikeVM::match(std::string_view text, Captures* caps) {
+    Captures tmp;
+    return run(text, 0, true, true, caps ? *caps : tmp);
+}
+
+bool PikeVM::search(std::string_view text, Captures& caps, size_t pos) {
+    return run(text, pos, false, false, caps);
+}
+
+std::vector<Captures> PikeVM::find_all(std::string_view text) {
+    std::vector<Captures> res;
+    Captures caps;
+    size_t pos = 0;
+    while (pos <= text.size() && search(text, caps, pos)) {
+        res.push_back(caps);
+        pos = after_match(caps[0]);
+    }
+    return res;
+}
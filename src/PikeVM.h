@@ -0,0 +1,72 @@
+#ifndef __PIKE_VM_H__
+#define __PIKE_VM_H__
+
+#include "DFA.h"
+
+// spans of the capture groups of a match, group 0 is the whole match
+struct Captures {
+    std::vector<Match> groups; // unset groups are {npos, npos}
+
+    bool has(size_t i) const {
+        return i < groups.size() && groups[i].start != std::string::npos;
+    }
+
+    const Match& operator[](size_t i) const {
+        return groups[i];
+    }
+
+    size_t size() const {
+        return groups.size();
+    }
+};
+
+// Thompson NFA simulation (Pike VM) with capture slots, O(text * states).
+// Threads run in priority order, so matches are leftmost-first with greedy and
+// lazy quantifiers as in backtracking engines, but without the exponential cases.
+class PikeVM {
+public:
+    PikeVM(NFA* nfa);
+
+    // the whole text is matched
+    bool match(std::string_view text, Captures* caps=nullptr);
+    // leftmost-first match starting at or after pos
+    bool search(std::string_view text, Captures& caps, size_t pos=0);
+    // all non-overlapping matches
+    std::vector<Captures> find_all(std::string_view text);
+
+    size_t groups() const;
+    // group id of a named group, -1 if none
+    int group_index(const std::string& name) const;
+
+private:
+    // states of the running threads in priority order, with their slots
+    struct Threads {
+        std::vector<uint32_t> dense;
+        std::vector<uint32_t> sparse;
+        std::vector<size_t> slots;  // [index in dense * nslots + slot]
+        size_t size = 0;
+
+        void init(size_t states, size_t nslots);
+        bool contains(uint32_t s) const;
+        size_t insert(uint32_t s);
+    };
+
+    void add_thread(Threads& l, State s, size_t pos, std::string_view text, size_t* slots);
+    bool run(std::string_view text, size_t pos, bool anchored, bool full, Captures& caps);
+
+private:
+    struct Frame {
+        State state;    // state to add
+        int slot;       // or slot to restore, if >= 0
+        size_t old;
+    };
+
+    NFA* nfa;
+    size_t nslots;
+    Threads clist, nlist;
+    std::vector<Frame> stk;
+    std::vector<size_t> scratch;   // slots of a new thread
+    std::vector<size_t> matched;
+};
+
+#endif // __PIKE_VM_H__
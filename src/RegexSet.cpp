@@ -0,0 +1,81 @@
+#include "RegexSet.h"
+#include "unicode.h"
+#include "DFAFile.h"
+
+RegexSet::RegexSet(bool anchored, bool utf8): anchored(anchored), utf8(utf8) {
+}
+
+size_t RegexSet::add(const std::string& pattern) {
+    if (dfa) {
+        throw std::runtime_error("RegexSet is already compiled");
+    }
+    std::unique_ptr<ExprRoot> root(regex_parse(utf8_to_uhhhh(pattern), false, false));
+    if (!root) {
+        throw std::runtime_error("Invalid pattern #" + std::to_string(roots.size()) + ": " + pattern);
+    }
+    roots.push_back(std::move(root));
+    return roots.size() - 1;
+}
+
+void RegexSet::compile() {
+    std::vector<ExprNode*> exprs;
+    for (auto& root : roots) {
+        exprs.push_back(root.get());
+    }
+    nfa = std::make_unique<NFA>(false);
+    nfa->generate(exprs, utf8, anchored);
+    dfa = std::make_unique<DFA>(nfa.get());
+    dfa->generate();
+}
+
+void RegexSet::save(std::ostream& os) const {
+    if (!dfa) {
+        throw std::runtime_error("RegexSet is not compiled");
+    }
+    write_dfa_file(os, dfa->get_table(), nullptr, NO_MATCH, roots.size(), anchored);
+}
+
+size_t RegexSet::states() const {
+    return dfa ? dfa->get_table().states() : 0;
+}
+
+std::vector<size_t> RegexSet::matches(std::string_view text) const {
+    if (!dfa) {
+        throw std::runtime_error("RegexSet is not compiled");
+    }
+    std::vector<size_t> res;
+    const DFATable& t = dfa->get_table();
+    if (t.states() == 0 || roots.empty()) return res;
+
+    // each pattern set is collected once
+    std::vector<bool> seen(t.set_off.size() - 1, false);
+    std::vector<bool> found(roots.size(), false);
+    size_t left = roots.size();
+    auto collect = [&](uint32_t k) {
+        if (k == 0 || seen[k]) return;
+        seen[k] = true;
+        for (uint32_t i = t.set_off[k]; i < t.set_off[k+1]; i++) {
+            uint32_t p = t.set_ids[i];
+            if (!found[p]) {
+                found[p] = true;
+                left--;
+            }
+        }
+    };
+
+    uint32_t s = t.initial_bot;
+    if (!anchored) collect(t.tags[s]);
+    for (size_t i = 0; i < text.size() && s != DEAD_STATE && left > 0; i++) {
+        s = t.next(s, text[i]);
+        if (!anchored) collect(t.tags[s]);
+    }
+    if (s != DEAD_STATE) {
+        if (anchored) collect(t.tags[s]);
+        collect(t.eot_tags[s]);
+    }
+
+    for (size_t p = 0; p < found.size(); p++) {
+        if (found[p]) res.push_back(p);
+    }
+    return res;
+}
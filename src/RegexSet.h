@@ -0,0 +1,38 @@
+#ifndef __REGEX_SET_H__
+#define __REGEX_SET_H__
+
+#include "DFA.h"
+
+// many patterns determinized into one DFA whose states carry the ids of the
+// patterns they accept, so a single scan tells which patterns match
+class RegexSet {
+public:
+    // anchored patterns must match the whole text, others match anywhere in it
+    RegexSet(bool anchored=false, bool utf8=false);
+
+    // parse and add a pattern, return its id. throws on syntax errors
+    size_t add(const std::string& pattern);
+    // build the automaton after the last add
+    void compile();
+
+    // ids of the patterns matching text, in increasing order
+    std::vector<size_t> matches(std::string_view text) const;
+    // write the compiled automaton as an image for MappedDFA::matches
+    void save(std::ostream& os) const;
+
+    size_t size() const {
+        return roots.size();
+    }
+
+    // states of the compiled automaton
+    size_t states() const;
+
+private:
+    std::vector<std::unique_ptr<ExprRoot>> roots;
+    std::unique_ptr<NFA> nfa;
+    std::unique_ptr<DFA> dfa;
+    bool anchored;
+    bool utf8;
+};
+
+#endif // __REGEX_SET_H__
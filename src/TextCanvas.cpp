@@ -38,8 +38,24 @@ static std::string get_line(uint8_t bits) {
     return bits? " " : "";
 };
 
+// one byte of mask and two of glyph per cell
+#define MAX_CELLS   (1ull << 28)
+
+// glyph of each combination of line directions
+static const std::string& line_glyph(uint8_t bits) {
+    static const std::vector<std::string> s_lines = []() {
+        std::vector<std::string> v(LINED + 1);
+        for (uint8_t b = 1; b <= LINED; b++) {
+            v[b] = get_line(b);
+        }
+        return v;
+    }();
+    return s_lines[bits & LINED];
+}
+
 TextCanvas::TextCanvas(size_t height, size_t width): height(height),width(width) {
     assert(height > 0 && width > 0);
+    Resize(height, width);
 }
 
 void TextCanvas::Resize(size_t height, size_t width) {
@@ -47,11 +63,28 @@ void TextCanvas::Resize(size_t height, size_t width) {
 
     LOG_DEBUG("Change Canvas size %zu x %zu\n", height, width);
 
+    if (height > MAX_CELLS / width) {
+        throw std::overflow_error("TextCanvas " + std::to_string(height) + "x"
+            + std::to_string(width) + " cells, too large!");
+    }
     this->height = height;
     this->width = width;
-    canvas.clear();
-    overlay.clear();
-    size = 0;
+    overlay.assign(height * width, SPACES);
+    canvas.assign(height * width, 0);
+    glyphs.clear();
+    glyph_ids.clear();
+}
+
+uint16_t TextCanvas::glyph(const std::string& s) {
+    auto it = glyph_ids.find(s);
+    if (it != glyph_ids.end()) return it->second;
+    if (glyphs.size() > UINT16_MAX) {
+        throw std::overflow_error("TextCanvas too many distinct cells!");
+    }
+    uint16_t id = glyphs.size();
+    glyphs.push_back(s);
+    glyph_ids.emplace(s, id);
+    return id;
 }
 
 void TextCanvas::Set(const Pos& p, const std::string& s) {
@@ -60,75 +93,61 @@ void TextCanvas::Set(const Pos& p, const std::string& s) {
     if (i >= height || j >= width) {
         throw std::out_of_range("invalid postion");
     }
+    size_t k = i * width + j;
     if (s.empty()) {
-        overlay[i][j] = EMPTY;
-        size++;
+        overlay[k] = EMPTY;
     } else {
-        overlay[i][j] = FILLED;
-        canvas[i][j] = s;
-        size += 1;
-    }
-    if (size > 1024*1024*20) {
-        throw std::overflow_error("TextCanvas " + std::to_string(size) + " elements, too large!");
-    }
-}
-
-static inline uint8_t get_mask(const MMU& overlay, size_t i, size_t j) {
-    uint8_t mask = 0; 
-    auto row_it = overlay.find(i);
-    if (row_it != overlay.end()) {
-        auto it = row_it->second.find(j);
-        mask = (it == row_it->second.end())? 0 : it->second;
+        overlay[k] = FILLED;
+        canvas[k] = glyph(s);
     }
-    return mask;
 }
 
-std::string TextCanvas::Get(const Pos& p) {
+const std::string& TextCanvas::Get(const Pos& p) {
+    static const std::string s_space = " ";
+    static const std::string s_empty = "";
     auto [i, j] = p;
     if (i >= height || j >= width) {
-        return "";
+        return s_empty;
     }
 
-    uint8_t mask = get_mask(overlay, i, j);
-
-    std::string s;
+    size_t k = i * width + j;
+    uint8_t mask = overlay[k];
     if (mask == SPACES) {
-        s = " ";
+        return s_space;
     } else if (mask == EMPTY) {
-        s = "";
+        return s_empty;
     } else if (mask == FILLED) {
-        s = canvas[i][j];
-    } else {
-        s = get_line(mask);
+        return glyphs[canvas[k]];
     }
-    return s;
+    return line_glyph(mask);
 }
 
 void TextCanvas::Line(const Pos& a, const Pos& b) {
     auto [ai, aj] = a;
     auto [bi, bj] = b;
+    // cells off the canvas are dropped
+    auto mark = [this](size_t i, size_t j, uint8_t bits) {
+        if (i < height && j < width) overlay[i * width + j] |= bits;
+    };
     if (ai == bi) {
         auto [x, y] = std::minmax(aj, bj);
-        for (size_t j = x; j <= y; j++) {
-            if (j > x && j < y) {
-                overlay[ai][j] |= FROM_LEFT | FROM_RIGHT;
-                size++;
+        if (ai < height) {
+            uint8_t* row = &overlay[ai * width];
+            for (size_t j = x+1; j < std::min(y, width); j++) {
+                row[j] |= FROM_LEFT | FROM_RIGHT;
             }
         }
-        overlay[ai][x] |= FROM_RIGHT;
-        overlay[ai][y] |= FROM_LEFT;
-        size += 2;
+        mark(ai, x, FROM_RIGHT);
+        mark(ai, y, FROM_LEFT);
     } else if (aj == bj) {
         auto [x, y] = std::minmax(ai, bi);
-        for (size_t i = x; i <= y; i++) {
-            if (i > x && i < y) {
-                overlay[i][aj] |= FROM_UP | FROM_DOWN;
-                size++;
+        if (aj < width) {
+            for (size_t i = x+1; i < std::min(y, height); i++) {
+                overlay[i * width + aj] |= FROM_UP | FROM_DOWN;
             }
         }
-        overlay[x][aj] |= FROM_DOWN;
-        overlay[y][aj] |= FROM_UP;
-        size += 2;
+        mark(x, aj, FROM_DOWN);
+        mark(y, aj, FROM_UP);
     } else {
         DEBUG_OS << ai << ", " << aj << "    " << bi << ", " << bj << "\n";
         throw std::invalid_argument("invalid args");
@@ -141,19 +160,27 @@ void TextCanvas::Rect(const Pos& p, size_t height, size_t width,
     auto [i, j] = p;
     size_t a = i + height - 1;
     size_t b = j + width - 1;
+    if (a >= this->height || b >= this->width) {
+        throw std::out_of_range("invalid postion");
+    }
     auto tab_line = [style](TableLine line) {
         return get_table_line(style, line);
     };
 
     auto [start, end] = color;
 
+    // edges are sweeps over the grid, the glyphs are looked up once
+    uint16_t h_line = glyph(tab_line(TableLine::TAB_H_LINE));
     for (size_t k = j+1; k < b; k++) {
-        Set({i,k}, tab_line(TableLine::TAB_H_LINE));
-        Set({a,k}, tab_line(TableLine::TAB_H_LINE));
+        overlay[i * this->width + k] = overlay[a * this->width + k] = FILLED;
+        canvas[i * this->width + k] = canvas[a * this->width + k] = h_line;
     }
+    uint16_t left = glyph(start + tab_line(TableLine::TAB_V_LINE));
+    uint16_t right = glyph(tab_line(TableLine::TAB_V_LINE) + end);
     for (size_t k = i+1; k < a; k++) {
-        Set({k,j}, start + tab_line(TableLine::TAB_V_LINE));
-        Set({k,b}, tab_line(TableLine::TAB_V_LINE) + end);
+        overlay[k * this->width + j] = overlay[k * this->width + b] = FILLED;
+        canvas[k * this->width + j] = left;
+        canvas[k * this->width + b] = right;
     }
     Set({i, j}, start + tab_line(TableLine::TAB_LEFT_TOP));
     Set({i, b}, tab_line(TableLine::TAB_RIGHT_TOP) + end);
@@ -206,9 +233,8 @@ void TextCanvas::Arrow(const Pos& p, Dir d) {
 void TextCanvas::Dump(std::ostream& os) {
     for (size_t i = 0; i < height; i++) {
         for (size_t j = 0; j < width; j++) {
-            std::string s = Get({i,j});
-            os << s;
+            os << Get({i,j});
         }
         os << "\n";
     }
-}
\ No newline at end of file
+}
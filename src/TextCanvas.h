@@ -9,12 +9,6 @@
 
 using Pos = std::pair<size_t,size_t>;
 
-using MS = std::unordered_map<size_t,std::string>;
-using MMS = std::unordered_map<size_t,MS>;
-
-using MU = std::unordered_map<size_t,uint8_t>;
-using MMU = std::unordered_map<size_t,MU>;
-
 class TextCanvas {
 public:
     TextCanvas(size_t height=100, size_t width=100);
@@ -27,7 +21,7 @@ public:
     void Text(const Pos& p, const std::string& s, Align align=Align::LEFT);
     void Arrow(const Pos& p, Dir d);
 
-    std::string Get(const Pos& p);
+    const std::string& Get(const Pos& p);
     void Set(const Pos& p, const std::string& s);
 
     void Dump(std::ostream& os=std::cout);
@@ -39,12 +33,17 @@ public:
     // std::vector<size_t> RowCount(size_t row);
 
 
+private:
+    uint16_t glyph(const std::string& s);
+
 private:
     size_t height;
     size_t width;
-    MMS canvas;
-    MMU overlay;
-    size_t size = 0;
+    // row major cells: line directions or FILLED/EMPTY, and the glyph of FILLED cells
+    std::vector<uint8_t> overlay;
+    std::vector<uint16_t> canvas;
+    std::vector<std::string> glyphs;    // distinct cell strings
+    std::unordered_map<std::string,uint16_t> glyph_ids;
 };
 
 #endif // __TEXTCANVAS_H__
\ No newline at end of file
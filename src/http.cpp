@@ -1,8 +1,26 @@
 #include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <mutex>
 #include "http.h"
 #include "utils.h"
+#include "ThreadPool.h"
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <fcntl.h>
+#endif
+
+#define BUFFER_SIZE 1024
+#define MAX_HEADER_SIZE (64 * 1024)
+#define MAX_BODY_SIZE (16 * 1024 * 1024)
+// a connection is dropped if its request doesn't arrive in time,
+// or if it stays idle this long between keep-alive requests
+#define REQUEST_TIMEOUT_MS 10000
+#define KEEP_ALIVE_TIMEOUT_MS 5000
+#define KEEP_ALIVE_MAX 1000
 
 // 初始化 Socket 环境（Windows 需初始化 Winsock）
 static int socket_init() {
@@ -120,6 +138,50 @@ static void parse_http_request(HttpRequest& req, const std::string& raw_request)
 }
 
 
+// move the first complete request out of buf, false if more data is needed
+static bool take_request(std::string& buf, HttpRequest& req) {
+    size_t i = buf.find("\r\n\r\n");
+    if (i == std::string::npos) {
+        if (buf.size() > MAX_HEADER_SIZE) {
+            throw std::invalid_argument("Request header too large");
+        }
+        return false;
+    }
+    HttpRequest r;
+    parse_http_request(r, buf.substr(0, i + 4));
+    if (r.content_length > MAX_BODY_SIZE) {
+        throw std::invalid_argument("Request body too large");
+    }
+    if (buf.size() < i + 4 + r.content_length) {
+        return false;
+    }
+    r.body = buf.substr(i + 4, r.content_length);
+    buf.erase(0, i + 4 + r.content_length);
+    req = std::move(r);
+    return true;
+}
+
+// HTTP/1.1 keeps the connection unless told to close, HTTP/1.0 only if asked to keep it
+static bool keep_alive(const HttpRequest& req) {
+    std::string conn;
+    auto it = req.headers.find("connection");
+    if (it != req.headers.end()) {
+        conn = it->second;
+        std::transform(conn.begin(), conn.end(), conn.begin(), ::tolower);
+    }
+    if (req.version == "HTTP/1.1") return conn != "close";
+    return conn == "keep-alive";
+}
+
+static HttpResponse error_response(unsigned int status_code, const std::string& message) {
+    DEBUG_OS << "Resp: " << status_code << " " << message << "\n";
+    HttpResponse resp;
+    resp.status_code = status_code;
+    resp.body = message;
+    resp.content_type = "text/html";
+    return resp;
+}
+
 // 将 HttpResponse 转换为 HTTP 响应字符串
 static std::string http_response_to_string(const HttpResponse& res) {
     std::string http_str;
@@ -129,6 +191,7 @@ static std::string http_response_to_string(const HttpResponse& res) {
         switch (res.status_code) {
             case 200: status_msg = "OK"; break;
             case 204: status_msg = "No Content"; break;
+            case 400: status_msg = "Bad Request"; break;
             case 404: status_msg = "Not Found"; break;
             case 500: status_msg = "Internal Server Error"; break;
             // ...
@@ -153,18 +216,25 @@ static std::string http_response_to_string(const HttpResponse& res) {
     return http_str;
 }
 
-Http::Http(unsigned int port): port(port) {
-    client_fd = INVALID_FD;
+static std::string reply_string(HttpResponse& resp, bool keep) {
+    if (keep) {
+        resp.headers["Connection"] = "keep-alive";
+        resp.headers["Keep-Alive"] = "timeout=" + std::to_string(KEEP_ALIVE_TIMEOUT_MS / 1000)
+            + ", max=" + std::to_string(KEEP_ALIVE_MAX);
+    } else {
+        resp.headers["Connection"] = "close";
+    }
+    return http_response_to_string(resp);
+}
+
+Http::Http(unsigned int port, int backlog, size_t workers):
+    port(port), backlog(backlog), workers(workers) {
     fd = INVALID_FD;
 }
 
 Http::~Http() {
-    if (client_fd > 0) {
-        LOG_DEBUG("close fd %lld", client_fd);
-        CLOSE_FD(client_fd);
-    }
     if (fd > 0) {
-        LOG_DEBUG("close fd %lld", fd);
+        LOG_DEBUG("close fd %lld", (long long)fd);
         CLOSE_FD(fd);
         socket_cleanup();
     }
@@ -190,6 +260,9 @@ int Http::Start() {
         return -1;
     }
 
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+
     if (bind(fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) == -1) {
         print_socket_error("bind");
         CLOSE_FD(fd);
@@ -198,7 +271,7 @@ int Http::Start() {
         return -1;
     }
 
-    if (listen(fd, 5) == -1) {
+    if (listen(fd, backlog) == -1) {
         print_socket_error("listen");
         CLOSE_FD(fd);
         socket_cleanup();
@@ -206,104 +279,340 @@ int Http::Start() {
         return -1;
     }
     printf("Server started on http:://127.0.0.1:%u\n", port);
+    fflush(stdout);
+
+    return Serve();
+}
+
+#ifdef __linux__
+
+// one client of the event loop
+struct HttpConn {
+    SOCKET_FD fd;
+    std::string in;         // received, not parsed yet
+    std::string out;        // reply not sent yet
+    size_t sent = 0;
+    bool busy = false;      // its request is on the workers
+    bool closing = false;   // close once out is sent
+    bool eof = false;       // the peer sent all it will send
+    size_t served = 0;      // requests answered
+    std::chrono::steady_clock::time_point active;   // accepted or last answered
+    std::chrono::steady_clock::time_point started;  // first byte of the request in `in`
+};
+
+// epoll loop on non-blocking sockets: the loop thread only moves bytes,
+// requests are handled on the worker pool and their replies handed back through an eventfd.
+// Connections are kept alive, pipelined requests go to the workers one at a time so the
+// replies keep their order
+int Http::Serve() {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    int wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ep == -1 || wake == -1) {
+        print_socket_error("epoll");
+        if (ep != -1) close(ep);
+        if (wake != -1) close(wake);
+        return ServeBlocking();
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    // epoll data is a connection id, 0 and 1 are the listener and the eventfd
+    const uint64_t LISTENER = 0, WAKER = 1;
+    auto watch = [ep](int op, SOCKET_FD sock, uint64_t id, uint32_t events) {
+        struct epoll_event ev;
+        ev.events = events;
+        ev.data.u64 = id;
+        epoll_ctl(ep, op, sock, &ev);
+    };
+    watch(EPOLL_CTL_ADD, fd, LISTENER, EPOLLIN);
+    watch(EPOLL_CTL_ADD, wake, WAKER, EPOLLIN);
+
+    std::mutex mtx;
+    struct Reply {
+        uint64_t id;
+        std::string data;
+        bool keep;
+    };
+    std::vector<Reply> done;    // replies from the workers
+    ThreadPool pool(workers);
+    std::unordered_map<uint64_t,HttpConn> conns;
+    uint64_t next_id = 2;
+    LOG_DEBUG("serving with %zu workers\n", pool.size());
+
+    // reads until the peer's end but not while a request is on the workers,
+    // writes while a reply is pending
+    auto interest = [&](uint64_t id, HttpConn& c) {
+        watch(EPOLL_CTL_MOD, c.fd, id, (c.eof || c.busy ? 0 : EPOLLIN) | (c.out.empty() ? 0 : EPOLLOUT));
+    };
+
+    auto drop = [&](uint64_t id) {
+        auto it = conns.find(id);
+        if (it == conns.end()) return;
+        epoll_ctl(ep, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        CLOSE_FD(it->second.fd);
+        conns.erase(it);
+    };
+
+    // send what the socket takes, false if the connection is finished
+    auto flush = [&](uint64_t id, HttpConn& c) {
+        while (c.sent < c.out.size()) {
+            ssize_t n = send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                c.sent += n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                return false;
+            }
+        }
+        if (c.sent == c.out.size()) {
+            c.out.clear();
+            c.sent = 0;
+            if (c.closing) return false;
+        }
+        interest(id, c);
+        return true;
+    };
+
+    // hand the next complete request to the workers
+    auto dispatch = [&](uint64_t id, HttpConn& c) {
+        if (c.busy || c.closing) return true;
+        HttpRequest req;
+        try {
+            if (!take_request(c.in, req)) return true;
+        } catch (const std::exception& e) {
+            HttpResponse resp = error_response(400, e.what());
+            c.out += reply_string(resp, false);
+            c.closing = true;
+            return flush(id, c);
+        }
+        // a pipelined request already started arriving
+        if (!c.in.empty()) c.started = std::chrono::steady_clock::now();
+        c.busy = true;
+        interest(id, c);
+        bool keep = keep_alive(req) && c.served + 1 < KEEP_ALIVE_MAX;
+        pool.submit([this, id, keep, req = std::move(req), &mtx, &done, wake]() {
+            HttpResponse resp = HandleRequest(req);
+            std::string reply = reply_string(resp, keep);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                done.push_back({id, std::move(reply), keep});
+            }
+            uint64_t one = 1;
+            ssize_t r = write(wake, &one, sizeof(one));
+            (void)r;
+        });
+        return true;
+    };
+
+    const int MAX_EVENTS = 256;
+    struct epoll_event events[MAX_EVENTS];
+    char buffer[16 * BUFFER_SIZE];
+    auto last_sweep = std::chrono::steady_clock::now();
+    while (true) {
+        int n = epoll_wait(ep, events, MAX_EVENTS, 1000);
+        if (n < 0 && errno != EINTR) {
+            print_socket_error("epoll_wait");
+            break;
+        }
+        auto now = std::chrono::steady_clock::now();
+        for (int k = 0; k < n; k++) {
+            uint64_t id = events[k].data.u64;
+            if (id == LISTENER) {
+                while (true) {
+                    int client = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (client == -1) {
+                        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                            print_socket_error("accept");
+                        }
+                        if (errno == EINTR) continue;
+                        break;
+                    }
+                    uint64_t cid = next_id++;
+                    HttpConn& c = conns[cid];
+                    c.fd = client;
+                    c.active = now;
+                    watch(EPOLL_CTL_ADD, client, cid, EPOLLIN);
+                }
+                continue;
+            }
+            if (id == WAKER) {
+                uint64_t count;
+                ssize_t r = read(wake, &count, sizeof(count));
+                (void)r;
+                std::vector<Reply> replies;
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    replies.swap(done);
+                }
+                for (auto& reply : replies) {
+                    auto it = conns.find(reply.id);
+                    if (it == conns.end()) continue;    // the client is gone
+                    HttpConn& c = it->second;
+                    c.busy = false;
+                    c.served++;
+                    c.closing = !reply.keep;
+                    c.active = now;
+                    c.out += reply.data;
+                    // the next pipelined request, if it is in already
+                    bool alive = dispatch(reply.id, c) && flush(reply.id, c);
+                    if (alive && c.eof && !c.busy && c.out.empty()) alive = false;
+                    if (!alive) drop(reply.id);
+                }
+                continue;
+            }
+
+            auto it = conns.find(id);
+            if (it == conns.end()) continue;
+            HttpConn& c = it->second;
+            bool alive = !(events[k].events & (EPOLLERR | EPOLLHUP));
+            if (alive && (events[k].events & EPOLLIN)) {
+                // a complete request fits the limits, dispatch takes it or rejects the rest
+                while (c.in.size() < MAX_HEADER_SIZE + MAX_BODY_SIZE) {
+                    ssize_t r = recv(c.fd, buffer, sizeof(buffer), 0);
+                    if (r > 0) {
+                        if (c.in.empty()) c.started = now;
+                        c.in.append(buffer, r);
+                    } else if (r == 0) {
+                        c.eof = true;
+                        break;
+                    } else if (errno == EINTR) {
+                        continue;
+                    } else {
+                        alive = errno == EAGAIN || errno == EWOULDBLOCK;
+                        break;
+                    }
+                }
+                if (alive) alive = dispatch(id, c);
+                if (alive && c.eof) {
+                    // still answer a request sent before the peer's end
+                    alive = c.busy || !c.out.empty();
+                    if (alive) interest(id, c);
+                }
+            }
+            if (alive && (events[k].events & EPOLLOUT)) {
+                alive = flush(id, c);
+            }
+            if (!alive) drop(id);
+        }
+
+        // drop the clients which send nothing or too slowly, a request is timed from its
+        // first byte. A slow client holds only its own socket
+        if (now - last_sweep >= std::chrono::seconds(1)) {
+            last_sweep = now;
+            std::vector<uint64_t> idle;
+            for (auto& [cid, c] : conns) {
+                bool waiting = c.served > 0 && c.in.empty() && c.out.empty();
+                auto timeout = std::chrono::milliseconds(waiting ? KEEP_ALIVE_TIMEOUT_MS : REQUEST_TIMEOUT_MS);
+                auto since = c.in.empty() ? c.active : c.started;
+                if (!c.busy && now - since > timeout) {
+                    idle.push_back(cid);
+                }
+            }
+            for (uint64_t cid : idle) drop(cid);
+        }
+    }
+
+    for (auto& [cid, c] : conns) {
+        CLOSE_FD(c.fd);
+    }
+    close(wake);
+    close(ep);
+    return -1;
+}
+
+#else
+
+int Http::Serve() {
+    return ServeBlocking();
+}
+
+#endif
+
+// portable fallback: blocking accept, each connection is handled on the worker pool
+int Http::ServeBlocking() {
+    ThreadPool pool(workers);
 
     struct sockaddr_in client_addr;
     socklen_t client_len = sizeof(client_addr);
     while (true) {
-        client_fd = accept(fd, (struct sockaddr*)&client_addr, &client_len);
+        SOCKET_FD client_fd = accept(fd, (struct sockaddr*)&client_addr, &client_len);
         if (client_fd == INVALID_FD) {
             print_socket_error("accept");
             continue;
         }
-        try {
-            HandleConnection(client_fd);
-        } catch (const std::exception& e) {
-            DEBUG_OS << "error: " << e.what() << "\n";
-        }
-        CLOSE_FD(client_fd);
-        client_fd = INVALID_FD;
+        pool.submit([this, client_fd]() {
+            try {
+                HandleConnection(client_fd);
+            } catch (const std::exception& e) {
+                DEBUG_OS << "error: " << e.what() << "\n";
+            }
+            CLOSE_FD(client_fd);
+        });
     }
-
-    CLOSE_FD(fd);
-    socket_cleanup();
-    fd = INVALID_FD;
     return 0;
-
 }
-#define BUFFER_SIZE 1024
 
 int Http::HandleConnection(SOCKET_FD client_fd) {
-    set_recv_timeout(client_fd, 1000);
+    set_recv_timeout(client_fd, KEEP_ALIVE_TIMEOUT_MS);
 
-    bool header = false;
-    HttpRequest req;
     char buffer[BUFFER_SIZE];
     std::string data;
-    while (true) {
-        ssize_t nread = recv(client_fd, buffer, BUFFER_SIZE - 1, 0);
-        if (nread > 0) {
-            if (!header) {
+    for (size_t served = 0; served < KEEP_ALIVE_MAX; served++) {
+        HttpRequest req;
+        while (true) {
+            try {
+                if (take_request(data, req)) break;
+            } catch (const std::exception& e) {
+                HttpResponse resp = error_response(400, e.what());
+                std::string reply = reply_string(resp, false);
+                send(client_fd, reply.c_str(), reply.size(), 0);
+                return 0;
+            }
+            ssize_t nread = recv(client_fd, buffer, BUFFER_SIZE, 0);
+            if (nread > 0) {
                 data.append(buffer, nread);
-                if (data.find("\r\n\r\n") != std::string::npos) {
-                    // 头部数据接收完整
-                    parse_http_request(req, data);
-                    header = true;
+            } else if (nread < 0) {
+                if (nread != EOF) {
+                    print_socket_error("recv");
                 }
+                return nread;
             } else {
-                req.body.append(buffer, nread);
-            }
-            if (req.body.size() >= req.content_length) {
-                break;
-            }
-        } else if (nread < 0) {
-            if (nread != EOF) {
-                print_socket_error("recv");
+                // closed
+                return 0;
             }
-            return nread;
-        } else {
-            // closed
-            return 0;
         }
-    }
 
-    try {
-        HandleRequest(client_fd, req);
-    } catch (const std::exception& e) {
-        std::cerr << "Exception: " << e.what() << std::endl;
-        RespError(client_fd, 500, e.what());
+        bool keep = keep_alive(req) && served + 1 < KEEP_ALIVE_MAX;
+        HttpResponse resp = HandleRequest(req);
+        std::string reply = reply_string(resp, keep);
+        if (send(client_fd, reply.c_str(), reply.size(), 0) < 0 || !keep) break;
     }
-
     return 0;
 }
 
-
-void Http::HandleRequest(SOCKET_FD client_fd, const HttpRequest& req) {
+// run the route of req, errors become error responses
+HttpResponse Http::HandleRequest(const HttpRequest& req) {
     DEBUG_OS << req.method << " " << req.path << "\n";
     auto it = routes.find(req.path);
-    if (it != routes.end()) {
+    if (it == routes.end()) {
+        DEBUG_OS << "not found route of " << req.path << "\n";
+        return error_response(404, "<html><head><title>404 Page Not Found</title></head>"
+            "<body><h1>404 Page Not Found</h1></body></html>");
+    }
+    try {
         HttpResponse resp = it->second(req);
         if (resp.status_code == 0) {
             resp.status_code = 200;
         }
-        std::string reply = http_response_to_string(resp);
-        send(client_fd, reply.c_str(), reply.size(), 0);
-    } else {
-        DEBUG_OS << "not found route of " << req.path << "\n";
-        RespError(client_fd, 404, "<html><head><title>404 Page Not Found</title></head>"
-            "<body><h1>404 Page Not Found</h1></body></html>");
+        return resp;
+    } catch (const std::exception& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return error_response(500, e.what());
     }
 }
 
-void Http::RespError(SOCKET_FD client_fd, unsigned int status_code, const std::string& message) {
-    DEBUG_OS << "Resp: " << status_code << " " << message << "\n";
-    HttpResponse resp;
-    resp.status_code = status_code;
-    resp.body = message;
-    resp.content_type = "text/html";
-    std::string reply = http_response_to_string(resp);
-    send(client_fd, reply.c_str(), reply.size(), 0);
-}
-
 void Http::Route(const std::string& path, RouteFn fn)
 {
     routes[path] = fn;
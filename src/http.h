@@ -54,20 +54,22 @@ class Http {
     using RouteFn = std::function<HttpResponse(const HttpRequest& req)>;
 
     unsigned int port;
+    int backlog;        // pending connections queued by listen
+    size_t workers;     // threads running the routes, 0 for all cores
     SOCKET_FD fd;
-    SOCKET_FD client_fd;
     std::unordered_map<std::string,RouteFn> routes;
 
 public:
-    Http(unsigned int port);
+    Http(unsigned int port, int backlog=SOMAXCONN, size_t workers=0);
     ~Http();
     void Route(const std::string& path, RouteFn fn);
     int Start();
 
 private:
+    int Serve();
+    int ServeBlocking();
     int HandleConnection(SOCKET_FD client_fd);
-    void HandleRequest(SOCKET_FD client_fd, const HttpRequest& req);
-    void RespError(SOCKET_FD client_fd, unsigned int status_code, const std::string& message);
+    HttpResponse HandleRequest(const HttpRequest& req);
 };
 
 #endif // HTTP_H
\ No newline at end of file
@@ -5,11 +5,13 @@
 #include "unicode.h"
 #include "GraphBox.h"
 #include "RegexGenerator.h"
-#include "DFA.h"
-#include "DFACanvas.h"
-#include "GraphSvg.h"
-#include "GraphHtml.h"
 #include "GraphHttp.h"
+#include "Batch.h"
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+#endif
 
 
 int run(int argc, char* argv[]) {
@@ -21,11 +23,30 @@ int run(int argc, char* argv[]) {
     }
 
     if (args.port > 0) {
-        GraphHttp http(args.port);
+        GraphHttp http(args.port, args.backlog, args.jobs);
         http.Start();
         return 0;
     }
 
+    GraphBox::set_encoding(args.utf8);
+    GraphBox::set_color(args.color);
+
+    // images are binary, no newline translation
+    auto mode = args.format & Utils::FMT_DFABIN ? std::ios::out | std::ios::binary : std::ios::out;
+#ifdef _WIN32
+    if (args.format & Utils::FMT_DFABIN) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    if (args.batch) {
+        if (args.output.empty()) {
+            return run_batch(std::cin, std::cout, std::cerr, args);
+        }
+        std::ofstream of(args.output, mode);
+        ret = run_batch(std::cin, of, std::cerr, args);
+        std::cout << "Exported result to " << args.output << std::endl;
+        return ret;
+    }
+
     args.expr = utf8_to_uhhhh(args.expr);
 
     if (g_debug) std::cout << "  Input Expression: " << args.expr << std::endl;
@@ -35,64 +56,11 @@ int run(int argc, char* argv[]) {
         return -1;
     }
 
-    auto dump = [&args, &root](std::ostream& os) {
-        std::string expr_str = root->stringify(args.color);
-
-        GraphBox::set_encoding(args.utf8);
-        GraphBox::set_color(args.color);
-        std::unique_ptr<RootBox> box(expr_to_box(root.get()));
-
-        // html and svg is exclusive
-        if (args.format & Utils::FMT_HTML) {
-            std::stringstream html_os;
-            box->dump(html_os);
-            GraphHtml html(expr_str, html_os.str());
-            html.dump(os);
-            return;
-        } else if (args.format & Utils::FMT_SVG) {
-            GraphSvg svg(expr_str, box->get_rows());
-            svg.dump(os);
-            return;
-        } else if (args.format & Utils::FMT_XML) {
-            os << root->xml() << std::endl;
-            return;
-        }
-
-        os << "Regular Expression: " << expr_str << std::endl;
-
-        if (args.format & Utils::FMT_TREE) {
-            os << root->format(4, args.color) << std::endl;
-        } 
-
-        if (args.format & Utils::FMT_GRAPH) {
-            box->dump(os);
-        }
-
-        if (args.format & Utils::FMT_NFA) {
-            NFA nfa(args.color);
-            nfa.generate(root.get(), args.utf8);
-            nfa.dump(os);
-        }
-
-        if (args.format & Utils::FMT_DFA) {
-            NFA nfa(args.color);
-            nfa.generate(root.get(), args.utf8);
-
-            DFA dfa(&nfa);
-            dfa.generate();
-            dfa.dump(os);
-
-            DFACanvas t(&dfa);
-            t.render();
-            t.dump(os);
-        } 
-    };
-
     if (args.output.empty()) {
-        dump(std::cout);
+        dump_expr(std::cout, root.get(), args);
     } else {
-        std::ofstream of(args.output);
-        dump(of);
+        std::ofstream of(args.output, mode);
+        dump_expr(of, root.get(), args);
         std::cout << "Exported result to " << args.output << std::endl;
     }
 
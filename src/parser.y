@@ -1,10 +1,12 @@
+%code requires {
+struct ParseContext;
+}
+
 %{
 #include <unistd.h>
 #include <iostream>
 #include <iomanip>
-#include <FlexLexer.h>
-#include "Parser.h"
-#include "y.tab.hh"
+#include "ParseContext.h"
 
 // #define YYDEBUG 1
 #define YYTOKEN_TABLE 1
@@ -12,77 +14,90 @@
 #define YYMALLOC yy_malloc
 #define YYFREE yy_free
 
-extern size_t yycolumn;
-extern const char* g_yytext;
-
-extern int yylex();
-extern void reset_flex(const std::string& text);
 extern void lex_parse(const std::string& s);
 
-static std::string g_text;
-static ExprRoot* g_expr = nullptr;
+thread_local ParseContext* ParseContext::current = nullptr;
 
-static std::unordered_set<void*> yy_allocs;
+ParseContext::ParseContext(const std::string& text)
+: text(text), iss(text), lexer(&iss, this), arena(std::make_unique<Arena>()),
+  scope(arena.get()), prev(current) {
+    current = this;
+}
+
+ParseContext::~ParseContext() {
+    for (void* ptr : allocs) {
+        LOG_DEBUG("free %p", ptr);
+        std::free(ptr);
+    }
+    delete expr;
+    current = prev;
+}
 
 static void* yy_malloc(size_t size) {
     void* ptr = std::malloc(size);
     if (!ptr) throw std::bad_alloc();
-    yy_allocs.insert(ptr);
+    ParseContext::current->allocs.push_back(ptr);
     LOG_DEBUG("malloc %p", ptr);
     return ptr;
 }
 
 static void yy_free(void* ptr) {
-    yy_allocs.erase(ptr);
+    auto& allocs = ParseContext::current->allocs;
+    auto it = std::find(allocs.begin(), allocs.end(), ptr);
+    if (it != allocs.end()) allocs.erase(it);
     LOG_DEBUG("free %p", ptr);
     std::free(ptr);
 }
 
-static void yy_destroy() {
-    for (void* ptr : yy_allocs) {
-        LOG_DEBUG("free %p", ptr);
-        std::free(ptr);
-    }
-    yy_allocs.clear();
+static int yylex(YYSTYPE* yylval, YYLTYPE* yylloc, ParseContext* ctx) {
+    return ctx->lexer.yylex(yylval, yylloc);
 }
 
-void yyerror(const std::string& msg)
+static void yyerror(ParseContext* ctx, const std::string& msg)
 {
-    int col = (g_yytext && *g_yytext)? yylloc.first_column : yylloc.last_column + 1;
-    std::string tok = g_yytext? g_yytext : "";
+    const char* yytext = ctx->yytext;
+    int col = (yytext && *yytext)? ctx->loc.first_column : ctx->loc.last_column + 1;
+    std::string tok = yytext? yytext : "";
 
     std::stringstream ss;
     ss << "Error: " << msg << ", at column " << col;
     if (!tok.empty()) ss << ": Token `" << tok << "` ";
 
-    std::cerr << "\033[31m" << ss.str() << "\033[0m" << std::endl;
+    std::string head = ss.str();
 
     std::string code;
     int err_col;
-    if (g_text.size() > 80) {
+    const std::string& text = ctx->text;
+    if (text.size() > 80) {
         size_t a = col;
         std::string prefix;
         if (col > 20) {
             a = col - 20;
             prefix = "... ";
         }
-        code = prefix + g_text.substr(a, 40);
+        code = prefix + text.substr(a, 40);
         err_col = col - a + prefix.size();
     } else {
-        code = g_text;
+        code = text;
         err_col = col;
     }
 
-    ss << "\n\n" << code << "\n" << std::setfill('_') << std::setw(err_col) << std::right << "^";
+    // leave std::cerr formatting untouched, concurrent errors must not interfere
+    std::string caret = std::string(std::max(err_col - 1, 0), '_') + "^";
+    ss << "\n\n" << code << "\n" << caret;
 
-    std::cerr << code << std::endl
-        << std::setfill('_') << std::setw(err_col) << std::right << "^" << std::endl;
+    if (ctx->verbose) std::cerr << "\033[31m" + head + "\033[0m\n" + code + "\n" + caret + "\n";
 
     throw std::runtime_error(ss.str());
 } 
 
+static void yyerror(YYLTYPE* loc, ParseContext* ctx, const char* msg) {
+    yyerror(ctx, msg);
+}
+
 void yyerror_throw(const std::string& msg) {
-    yyerror(msg);
+    assert(ParseContext::current);
+    yyerror(ParseContext::current, msg);
 }
 
 #ifdef RULE_DEBUG
@@ -101,6 +116,8 @@ void yyerror_throw(const std::string& msg) {
 %debug
 
 %locations
+%define api.pure full
+%param {ParseContext* ctx}
 
 // yylval
 %union {
@@ -116,8 +133,8 @@ void yyerror_throw(const std::string& msg) {
 
 %%
 root: expr {
-        g_expr = new ExprRoot($1);
-        g_expr->process_groupid();
+        ctx->expr = new ExprRoot($1);
+        ctx->expr->process_groupid();
     };
 
 expr: expr OR {
@@ -194,27 +211,25 @@ term: LITERAL optional_q { $$ = attach($1, $2); }
     ;
 %%
 
-std::unique_ptr<ExprRoot> regex_parse(const std::string& expr, bool debug) {
+std::unique_ptr<ExprRoot> regex_parse(const std::string& expr, bool debug, bool verbose) {
     if (expr.empty()) {
         throw std::runtime_error("Empty Expr!");
     }
+    // state of this call only, nodes live in its arena and are released together on error
+    ParseContext ctx(escape(expr));
+    ctx.verbose = verbose;
     try {
-        g_expr = nullptr;
-        g_text = escape(expr);
-        reset_flex(g_text);
-        int ret = yyparse();
+        int ret = yyparse(&ctx);
         if (ret) {
             throw std::runtime_error("yyparse failed");
         }
-        return std::unique_ptr<ExprRoot>(g_expr);
+        ExprRoot* root = ctx.expr;
+        ctx.expr = nullptr;
+        root->arena = std::move(ctx.arena);
+        return std::unique_ptr<ExprRoot>(root);
     } catch (const std::exception& e) {
-        if (debug) lex_parse(g_text);
+        if (debug) lex_parse(ctx.text);
         LOG_DEBUG("Exception occurred, destroy all");
-        ExprRoot::destroy();
-        yy_destroy();
-        g_expr = nullptr;
-        // todo: memory leaks
-        
         throw;
     }
 }
@@ -8,7 +8,9 @@
 #include <iomanip>
 #include <cstdint>
 #include <stdexcept>
-#include <regex>
+#include <cctype>
+#include <vector>
+#include <algorithm>
 
 // 辅助函数：检查 UTF-8 字节是否为续字节（10xxxxxx）
 static inline bool is_utf8_continuation(uint8_t byte) {
@@ -211,6 +213,55 @@ static inline std::string codepoint_to_utf8(uint32_t codepoint) {
     return utf8;
 }
 
+// 辅助函数：码点区间 [lo, hi] 转为 UTF-8 字节区间序列（跳过代理项）
+// 例如 [U+0080, U+07FF] -> [C2-DF][80-BF]
+using Utf8Seq = std::vector<std::pair<uint8_t,uint8_t>>;
+
+static inline void utf8_ranges(uint32_t lo, uint32_t hi, std::vector<Utf8Seq>& res) {
+    if (lo > hi || lo > 0x10FFFF) return;
+    hi = std::min(hi, (uint32_t)0x10FFFF);
+    if (lo <= 0xDFFF && hi >= 0xD800) {
+        if (lo < 0xD800) utf8_ranges(lo, 0xD7FF, res);
+        if (hi > 0xDFFF) utf8_ranges(0xE000, hi, res);
+        return;
+    }
+    // 按编码长度拆分
+    for (uint32_t max : {0x7Fu, 0x7FFu, 0xFFFFu}) {
+        if (lo <= max && hi > max) {
+            utf8_ranges(lo, max, res);
+            utf8_ranges(max + 1, hi, res);
+            return;
+        }
+    }
+    if (hi <= 0x7F) {
+        res.push_back({{(uint8_t)lo, (uint8_t)hi}});
+        return;
+    }
+    // 拆分到只有各字节独立取区间
+    for (int i = 1; i < 4; i++) {
+        uint32_t m = (1u << (6 * i)) - 1;
+        if ((lo & ~m) != (hi & ~m)) {
+            if ((lo & m) != 0) {
+                utf8_ranges(lo, lo | m, res);
+                utf8_ranges((lo | m) + 1, hi, res);
+                return;
+            }
+            if ((hi & m) != m) {
+                utf8_ranges(lo, (hi & ~m) - 1, res);
+                utf8_ranges(hi & ~m, hi, res);
+                return;
+            }
+        }
+    }
+    std::string a = codepoint_to_utf8(lo);
+    std::string b = codepoint_to_utf8(hi);
+    Utf8Seq seq;
+    for (size_t i = 0; i < a.size(); i++) {
+        seq.emplace_back(a[i], b[i]);
+    }
+    res.push_back(seq);
+}
+
 // 核心函数：\uhhhh 格式字符串转为 UTF-8
 static inline std::string uhhhh_to_utf8(const std::string& uhhhh_str) {
     std::string result;
@@ -382,19 +433,18 @@ static inline bool is_empty_width_char(uint32_t c) {
     }
 }
 
+// total length of the ANSI color sequences \x1B[...m in str
 static inline size_t ansi_size(const std::string& str) {
-    if (str.empty()) return 0;
-    // 正则表达式：匹配所有 ANSI 转义序列
-    // \x1B：ESC 字符（\033）；\[：匹配 [；[0-9;]*：匹配数字/分号；[a-zA-Z]：匹配结束符（m/H/J/K 等）
-    std::regex ansi_regex("\x1B\\[[0-9;]*m"); // 只匹配m结束符
-    
-    std::sregex_iterator it(str.begin(), str.end(), ansi_regex);
-    std::sregex_iterator end;
-    
     size_t len = 0;
-    for (; it != end; ++it) {
-        // const smatch& match = *it;
-        len += it->length();
+    size_t n = str.size();
+    for (size_t i = 0; i + 2 < n; i++) {
+        if (str[i] != '\x1B' || str[i+1] != '[') continue;
+        size_t j = i + 2;
+        while (j < n && (std::isdigit((unsigned char)str[j]) || str[j] == ';')) j++;
+        if (j < n && str[j] == 'm') {
+            len += j - i + 1;
+            i = j;
+        }
     }
     return len;
 }
@@ -84,17 +84,20 @@ int parse_args(Args& args, int argc, char* argv[]) {
     std::stringstream help;
     help 
         << "Version " << APP_VERSION << " (Tool to parse and visualize regular expression)\n"
-        << "Usage: " << app << " [-h|-v|-c|-u] [-o path] [-f format(s)] [-g len] [REGEX]\n"
+        << "Usage: " << app << " [-h|-v|-c|-u|-b] [-o path] [-f format(s)] [-g len] [-j n] [-q n] [REGEX]\n"
         << "Options:\n"
         << "  -h           show this helpful usage message\n"
         << "  -v           show version info\n"
         << "  -o path      specify output file path (default stdout)\n"
         << "  -f format    specify output format (default graph):\n"
-        << "                  graph/g, tree/t, nfa/n, dfa/d, svg/s, html/h, xml/x (multiply example: g,t,d)\n"
+        << "                  graph/g, tree/t, nfa/n, dfa/d, svg/s, html/h, xml/x, cpp/c, dfabin (multiply example: g,t,d)\n"
         << "  -c           print with ansi color\n"
         << "  -g           generate a random regular expression with specified length limit\n"
         << "  -u           enable utf8 encoding\n"
         << "  -p port      run as http server with specified port\n"
+        << "  -q n         listen backlog of the http server (default 1024)\n"
+        << "  -b           batch mode, parse each line of stdin as a separate expression\n"
+        << "  -j n         number of threads in batch mode or http server (default all cores)\n"
         << "  [REGEX]      specify regular expression input (read from stdin if missing)\n";
 
     args.format = FMT_NULL;
@@ -103,6 +106,9 @@ int parse_args(Args& args, int argc, char* argv[]) {
     args.utf8 = false;
     args.rand = 0;
     args.port = 0;
+    args.backlog = 1024;
+    args.batch = false;
+    args.jobs = 0;
 
     auto parse_format = [&args](const std::string& arg) {
         for (auto [i, k] : split(arg, ',')) {
@@ -122,6 +128,10 @@ int parse_args(Args& args, int argc, char* argv[]) {
                 fmt = FMT_HTML;
             } else if (s == "x" || s == "xml") {
                 fmt = FMT_XML;
+            } else if (s == "c" || s == "cpp") {
+                fmt = FMT_CPP;
+            } else if (s == "dfabin") {
+                fmt = FMT_DFABIN;
             } else {
                 return false;
             }
@@ -132,7 +142,7 @@ int parse_args(Args& args, int argc, char* argv[]) {
 
     auto parse_opt = [&]() {
         int opt;
-        while ((opt = getopt(argc, argv, "p:g:f:o:hvcdu")) != -1) {
+        while ((opt = getopt(argc, argv, "p:q:g:f:o:j:hvcdub")) != -1) {
             switch (opt) {
                 case 'd':
                     args.debug = true;
@@ -149,6 +159,20 @@ int parse_args(Args& args, int argc, char* argv[]) {
                 case 'c':
                     args.color = true;
                     break;
+                case 'b':
+                    args.batch = true;
+                    break;
+                case 'j':
+                    try {
+                        args.jobs = std::stoi(optarg);
+                        if (args.jobs <= 0) {
+                            throw std::runtime_error("Invalid option -j");
+                        }
+                    } catch(const std::exception& e) {
+                        std::cerr << "Failed to parse option -j: " << e.what() << std::endl; 
+                        return 1;
+                    }
+                    break;
                 case 'p':
                     try {
                         args.port = std::stoi(optarg);
@@ -160,6 +184,17 @@ int parse_args(Args& args, int argc, char* argv[]) {
                         return 1;
                     } 
                     break;
+                case 'q':
+                    try {
+                        args.backlog = std::stoi(optarg);
+                        if (args.backlog <= 0) {
+                            throw std::runtime_error("Invalid option -q");
+                        }
+                    } catch(const std::exception& e) {
+                        std::cerr << "Failed to parse option -q: " << e.what() << std::endl; 
+                        return 1;
+                    }
+                    break;
                 case 'g':
                     try {
                         args.rand = std::stoi(optarg);
@@ -200,7 +235,13 @@ int parse_args(Args& args, int argc, char* argv[]) {
 
     if (args.format == FMT_NULL) args.format = FMT_GRAPH;
 
-    if (args.port == 0 && args.expr.empty()) {
+    // one C++ header per line doesn't compile as a single output
+    if (args.batch && (args.format & FMT_CPP)) {
+        std::cerr << "Format cpp can't be used in batch mode" << std::endl;
+        return -1;
+    }
+
+    if (args.port == 0 && args.expr.empty() && !args.batch) {
         if (args.rand > 0) {
             RegexGenerator g;
             args.expr = g.generate(args.rand);
@@ -212,7 +253,7 @@ int parse_args(Args& args, int argc, char* argv[]) {
         }
     }
 
-    if (args.port == 0 && args.expr.empty()) {
+    if (args.port == 0 && args.expr.empty() && !args.batch) {
         std::cerr << "No expression input!" << std::endl;
         std::cerr << help.str() << std::endl;
         return -1;
@@ -220,8 +261,8 @@ int parse_args(Args& args, int argc, char* argv[]) {
 
     g_debug = args.debug;
 
-    LOG_DEBUG("options: {format: 0x%x, color: %d, utf8: %d, rand: %d, port: %d}\n",
-        args.format, args.color, args.utf8, args.rand, args.port);
+    LOG_DEBUG("options: {format: 0x%x, color: %d, utf8: %d, rand: %d, port: %d, backlog: %d, batch: %d, jobs: %d}\n",
+        args.format, args.color, args.utf8, args.rand, args.port, args.backlog, args.batch, args.jobs);
     return 0;
 }
 
@@ -30,6 +30,8 @@ enum FMT {
     FMT_DFA = 0x20,
     FMT_HTML = 0x40,
     FMT_XML = 0x80,
+    FMT_CPP = 0x100,
+    FMT_DFABIN = 0x200,
 };
 
 struct Args {
@@ -41,6 +43,9 @@ struct Args {
     bool utf8;
     int rand;
     int port;
+    int backlog;    // listen backlog of the http server
+    bool batch;     // one expression per input line
+    int jobs;       // worker threads of batch mode and the http server, 0 for all cores
 };
 
 int parse_args(Args& args, int argc, char* argv[]);
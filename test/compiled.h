@@ -0,0 +1,29 @@
+#ifndef __TEST_COMPILED_H__
+#define __TEST_COMPILED_H__
+
+#include <type_traits>
+#include "Parser.h"
+#include "DFA.h"
+
+// NFA of expr, the parse tree is only needed while generating
+static inline NFA compile_nfa(const std::string& expr, bool utf8=false) {
+    std::unique_ptr<ExprRoot> root(regex_parse(expr));
+    NFA nfa(false);
+    nfa.generate(root.get(), utf8);
+    return nfa;
+}
+
+// expr compiled for one engine on its NFA: DFA, LazyDFA or PikeVM
+template<typename Engine>
+struct Compiled {
+    NFA nfa;
+    Engine engine;
+
+    template<typename... Args>
+    Compiled(const std::string& expr, bool utf8=false, Args... args):
+        nfa(compile_nfa(expr, utf8)), engine(&nfa, args...) {
+        if constexpr (std::is_same_v<Engine, DFA>) engine.generate();
+    }
+};
+
+#endif // __TEST_COMPILED_H__
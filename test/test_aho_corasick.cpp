@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <random>
+
+#include "AhoCorasick.h"
+#include "compiled.h"
+
+TEST(AhoCorasick, search) {
+    AhoCorasick ac({"he", "she", "his", "hers"});
+    EXPECT_EQ(ac.states(), 10);
+    EXPECT_TRUE(ac.match("hers"));
+    EXPECT_FALSE(ac.match("her"));
+    EXPECT_EQ(ac.first("ushers", 0), 1);
+    EXPECT_EQ(ac.first("ushers", 2), 2);
+    EXPECT_EQ(ac.first("ushers", 4), NO_MATCH);
+
+    // leftmost first, then the longest from there
+    Match m;
+    EXPECT_TRUE(ac.search("ushers", m));
+    EXPECT_EQ(m.start, 1);
+    EXPECT_EQ(m.end, 4);
+    EXPECT_TRUE(ac.search("ushers", m, 2));
+    EXPECT_EQ(m.start, 2);
+    EXPECT_EQ(m.end, 6);
+    auto res = ac.find_all("this hershe");
+    ASSERT_EQ(res.size(), 3);
+    EXPECT_EQ(res[0].start, 1);
+    EXPECT_EQ(res[0].end, 4);
+    EXPECT_EQ(res[1].start, 5);
+    EXPECT_EQ(res[1].end, 9);
+    EXPECT_EQ(res[2].start, 9);
+    EXPECT_EQ(res[2].end, 11);
+
+    EXPECT_THROW(AhoCorasick({"a", ""}), std::invalid_argument);
+}
+
+TEST(AhoCorasick, make_matcher) {
+    NFA words = compile_nfa("(aab|aac|aba|abc|(ba)a|bbc)");
+    EXPECT_EQ(words.get_literals().words,
+        std::vector<std::string>({"aab", "aac", "aba", "abc", "baa", "bbc"}));
+    auto m = make_matcher(&words);
+    EXPECT_NE(dynamic_cast<AhoCorasick*>(m.get()), nullptr);
+    EXPECT_EQ(m->find_all("xaabbaaabc").size(), 3);
+
+    NFA other = compile_nfa("aab|a+c");
+    EXPECT_TRUE(other.get_literals().words.empty());
+    EXPECT_NE(dynamic_cast<DFA*>(make_matcher(&other).get()), nullptr);
+}
+
+// same matches as the DFA of the alternation, and as the prefilter of a larger expression
+TEST(AhoCorasick, same_as_dfa) {
+    std::mt19937 rng(3);
+    std::string expr;
+    for (int i = 0; i < 40; i++) {
+        if (i) expr += "|";
+        int k = 3 + rng() % 2;
+        for (int j = 0; j < k; j++) expr += 'a' + rng() % 3;
+    }
+    Compiled<DFA> dfa(expr);
+    auto ac = make_matcher(&dfa.nfa);
+    ASSERT_NE(dynamic_cast<AhoCorasick*>(ac.get()), nullptr);
+    Compiled<DFA> inner("(" + expr + ")d");
+    EXPECT_GT(inner.nfa.get_literals().prefixes.size(), 16);
+
+    for (int round = 0; round < 200; round++) {
+        std::string text;
+        int n = rng() % 30;
+        for (int i = 0; i < n; i++) text += "abcd"[rng() % 4];
+        auto a = dfa.engine.find_all(text);
+        auto b = ac->find_all(text);
+        ASSERT_EQ(a.size(), b.size()) << text;
+        for (size_t i = 0; i < a.size(); i++) {
+            EXPECT_EQ(a[i].start, b[i].start) << text;
+            EXPECT_EQ(a[i].end, b[i].end) << text;
+        }
+        // leftmost-longest by brute force
+        Match want{NO_MATCH, 0}, m;
+        for (size_t s = 0; s <= text.size() && want.start == NO_MATCH; s++) {
+            for (size_t e = text.size(); e > s; e--) {
+                if (inner.engine.match(text.substr(s, e - s))) {
+                    want = {s, e};
+                    break;
+                }
+            }
+        }
+        EXPECT_EQ(inner.engine.search(text, m), want.start != NO_MATCH) << text;
+        if (want.start != NO_MATCH) {
+            EXPECT_EQ(m.start, want.start) << text;
+            EXPECT_EQ(m.end, want.end) << text;
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include "base64.h"
+
+TEST(Base64, rfc4648) {
+    std::vector<std::pair<std::string,std::string>> cases = {
+        {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+        {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"},
+    };
+    for (auto& [raw, enc] : cases) {
+        EXPECT_EQ(base64_encode(raw), enc);
+        EXPECT_EQ(base64_decode(enc), raw);
+    }
+    EXPECT_EQ(base64_decode("Zm9v\r\nYmE=\n"), "fooba");
+    EXPECT_THROW(base64_decode("Zm9vY"), std::invalid_argument);
+    EXPECT_THROW(base64_decode("Zg=a"), std::invalid_argument);
+    EXPECT_THROW(base64_decode("Z==="), std::invalid_argument);
+}
+
+TEST(Base64, roundtrip) {
+    std::mt19937 rng(7);
+    for (size_t n = 0; n < 300; n++) {
+        std::string raw(n, '\0');
+        for (auto& c : raw) c = rng();
+        std::string enc = base64_encode(raw);
+        EXPECT_EQ(enc.size(), (n + 2) / 3 * 4);
+        EXPECT_EQ(base64_decode(enc), raw);
+    }
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <iostream>
+#include <sstream>
+#include <atomic>
+
+#include "Batch.h"
+#include "ThreadPool.h"
+
+static Utils::Args batch_args(int jobs) {
+    Utils::Args args;
+    args.format = Utils::FMT_TREE;
+    args.color = false;
+    args.debug = false;
+    args.utf8 = false;
+    args.rand = 0;
+    args.port = 0;
+    args.batch = true;
+    args.jobs = jobs;
+    return args;
+}
+
+TEST(BATCH, ordered) {
+    std::vector<std::string> lines = {"a+b", "(ab", "[0-9]{2,}", "", "x|y", "a{3,2}", "(?:z)*"};
+    std::string input;
+    for (int i=0; i<50; i++) {
+        for (auto& l : lines) input += l + "\n";
+    }
+
+    // sequential result of the good lines
+    std::string expect;
+    for (int i=0; i<50; i++) {
+        for (auto& l : lines) {
+            if (l.empty() || l == "(ab" || l == "a{3,2}") continue;
+            std::unique_ptr<ExprRoot> root(regex_parse(l));
+            std::stringstream ss;
+            dump_expr(ss, root.get(), batch_args(1));
+            expect += ss.str();
+        }
+    }
+
+    std::istringstream is(input);
+    std::stringstream os, es;
+    EXPECT_EQ(run_batch(is, os, es, batch_args(4)), 1);
+    EXPECT_EQ(os.str(), expect);
+
+    // one error per bad line, in input order
+    std::string err;
+    std::vector<std::string> errs;
+    while (getline(es, err)) errs.push_back(err);
+    ASSERT_EQ(errs.size(), 100);
+    EXPECT_EQ(errs[0].find("Error: line 2: "), 0);
+    EXPECT_EQ(errs[1].find("Error: line 6: "), 0);
+    EXPECT_EQ(errs[99].find("Error: line 349: "), 0);
+
+    std::istringstream good("a\nb\n");
+    std::stringstream os2, es2;
+    EXPECT_EQ(run_batch(good, os2, es2, batch_args(3)), 0);
+    EXPECT_TRUE(es2.str().empty());
+}
+
+TEST(BATCH, thread_pool) {
+    std::atomic<int> count{0};
+    std::vector<std::future<int>> res;
+    {
+        ThreadPool pool(4);
+        EXPECT_EQ(pool.size(), 4);
+        for (int i=0; i<1000; i++) {
+            res.push_back(pool.submit([i, &count]() {
+                count++;
+                return i * i;
+            }));
+        }
+    }
+    // all queued tasks are done when the pool is destroyed
+    EXPECT_EQ(count, 1000);
+    for (int i=0; i<1000; i++) {
+        EXPECT_EQ(res[i].get(), i * i);
+    }
+}
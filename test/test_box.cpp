@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <iostream>
 #include "GraphBox.h"
+#include "GraphSvg.h"
 
 void dump_rows(const Rows& rows) {
     for (const auto& row : rows) {
@@ -48,4 +49,41 @@ TEST(GraphBox, box_expand) {
     EXPECT_EQ(span.right, 3);
     EXPECT_EQ(span.top, 0);
     EXPECT_EQ(span.bottom, 0);
-}
\ No newline at end of file
+}
+
+// identical subtrees at the same color share one rendering, with the same rows as without sharing
+TEST(GraphBox, shared_render) {
+    auto render = [](const std::string& expr, bool color, size_t hits, size_t rendered) {
+        GraphBox::set_color(color);
+        std::unique_ptr<ExprRoot> root(regex_parse(expr));
+        RenderCache cache;
+        Rows shared = expr_to_box(root.get(), true, &cache)->get_rows();
+        Rows plain = expr_to_box(root.get(), false)->get_rows();
+        GraphBox::set_color(false);
+        EXPECT_EQ(shared, plain) << expr;
+        EXPECT_EQ(cache.hits, hits) << expr;
+        EXPECT_EQ(cache.rendered.size(), rendered) << expr;
+    };
+    render("\\d\\d\\d\\d", false, 3, 2);
+    render("(?:abc)(?:abc)", false, 1, 4);
+    render("ab|ab", true, 1, 3);
+    // the colors differ, nothing is shared
+    render("\\d\\d\\d\\d", true, 0, 5);
+
+    // groups differ in their ids, only their contents are shared
+    render("(a\\d+)|(a\\d+)", false, 1, 6);
+}
+
+TEST(GraphSvg, text_runs) {
+    Rows rows = {"  ┏━━┓ ab", "中文" RED "x" NC "x"};
+    GraphSvg svg("a", rows);
+    std::stringstream os;
+    svg.dump(os);
+    std::string s = os.str();
+    EXPECT_NE(s.find("<tspan y=\"56\" x=\"24\" textLength=\"32\">┏━━┓</tspan>\n"
+        "<tspan x=\"64\" textLength=\"16\">ab</tspan>\n"), std::string::npos) << s;
+    // wide glyphs and colors split the runs
+    EXPECT_NE(s.find("<tspan y=\"70\" x=\"8\" textLength=\"32\">中文</tspan>\n"
+        "<tspan x=\"40\" fill=" + strwraperr(esc_code_color(RED)) + ">x</tspan>\n"
+        "<tspan x=\"48\">x</tspan>\n"), std::string::npos) << s;
+}
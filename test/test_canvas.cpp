@@ -0,0 +1,29 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "TextCanvas.h"
+
+TEST(TextCanvas, draw) {
+    TextCanvas c(5, 8);
+    c.Line({2,0}, {2,7});
+    c.Line({0,3}, {4,3});
+    EXPECT_EQ(c.Get({2,3}), Line::CROSS);
+    EXPECT_EQ(c.Get({2,0}), Line::HORIZON);
+    EXPECT_EQ(c.Get({4,3}), Line::VERTICAL);
+    EXPECT_EQ(c.Get({1,1}), " ");
+    EXPECT_EQ(c.Get({9,9}), "");
+
+    c.Rect({0,4}, 3, 4);
+    EXPECT_EQ(c.Get({0,4}), Line::LEFT_TOP);
+    EXPECT_EQ(c.Get({2,7}), Line::RIGHT_BOTTOM);
+    EXPECT_EQ(c.Get({1,7}), Line::VERTICAL);
+
+    // wide text leaves its trailing cells empty
+    c.Text({4,0}, "12");
+    std::stringstream ss;
+    c.Dump(ss);
+    std::string last = ss.str().substr(ss.str().rfind('\n', ss.str().size()-2) + 1);
+    EXPECT_EQ(last, "12 " + Line::VERTICAL + "    \n");
+
+    EXPECT_THROW(c.Set({5,0}, "x"), std::out_of_range);
+    EXPECT_THROW(TextCanvas(1 << 20, 1 << 20), std::overflow_error);
+}
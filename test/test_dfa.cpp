@@ -0,0 +1,306 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#include "Parser.h"
+#include "DFA.h"
+#include "LazyDFA.h"
+#include "PikeVM.h"
+#include "DFACode.h"
+#include "compiled.h"
+
+TEST(DFA, match) {
+    Compiled<DFA> c("a+b*[0-9]+");
+    EXPECT_TRUE(c.engine.match("a1"));
+    EXPECT_TRUE(c.engine.match("aabbb123"));
+    EXPECT_FALSE(c.engine.match("b123"));
+    EXPECT_FALSE(c.engine.match("aab"));
+    EXPECT_FALSE(c.engine.match(""));
+
+    Compiled<DFA> d("(a[ab]c|b[bc]c|c[ac]c)");
+    EXPECT_TRUE(d.engine.match("abc"));
+    EXPECT_TRUE(d.engine.match("ccc"));
+    EXPECT_FALSE(d.engine.match("acc"));
+
+    Compiled<DFA> e("^\\d{2,3}-x?$");
+    EXPECT_TRUE(e.engine.match("12-"));
+    EXPECT_TRUE(e.engine.match("123-x"));
+    EXPECT_FALSE(e.engine.match("1-x"));
+}
+
+TEST(DFA, search) {
+    Compiled<DFA> c("\\d+");
+    Match m;
+    EXPECT_TRUE(c.engine.search("ab123cd", m));
+    EXPECT_EQ(m.start, 2);
+    EXPECT_EQ(m.end, 5);
+
+    EXPECT_TRUE(c.engine.search("ab123cd45", m, 5));
+    EXPECT_EQ(m.start, 7);
+    EXPECT_EQ(m.end, 9);
+
+    EXPECT_FALSE(c.engine.search("abcd", m));
+
+    Compiled<DFA> d("ab|abcd|c");
+    EXPECT_TRUE(d.engine.search("xabcd", m));
+    EXPECT_EQ(m.start, 1);
+    EXPECT_EQ(m.end, 5);
+}
+
+TEST(DFA, find_all) {
+    Compiled<DFA> c("[a-z]+\\d");
+    auto res = c.engine.find_all("ab1 cd2ef x9");
+    ASSERT_EQ(res.size(), 3);
+    EXPECT_EQ(res[0].start, 0);
+    EXPECT_EQ(res[0].end, 3);
+    EXPECT_EQ(res[1].start, 4);
+    EXPECT_EQ(res[1].end, 7);
+    EXPECT_EQ(res[2].start, 10);
+    EXPECT_EQ(res[2].length(), 2);
+
+    Compiled<DFA> d("a*");
+    res = d.engine.find_all("baa");
+    ASSERT_EQ(res.size(), 3);
+    EXPECT_EQ(res[0].length(), 0);
+    EXPECT_EQ(res[1].start, 1);
+    EXPECT_EQ(res[1].end, 3);
+    EXPECT_EQ(res[2].start, 3);
+}
+
+TEST(DFA, linear_search) {
+    // quadratic if every start position is tried
+    std::string text(40000, 'a');
+    Compiled<DFA> c("a*b");
+    LazyDFA lazy(&c.nfa);
+    Match m;
+    EXPECT_FALSE(c.engine.search(text, m));
+    EXPECT_TRUE(c.engine.find_all(text).empty());
+    EXPECT_FALSE(lazy.search(text, m));
+    EXPECT_TRUE(lazy.find_all(text).empty());
+
+    text += "b";
+    EXPECT_TRUE(c.engine.search(text, m, 10));
+    EXPECT_EQ(m.start, 10);
+    EXPECT_EQ(m.end, text.size());
+    EXPECT_TRUE(lazy.search(text, m));
+    EXPECT_EQ(m.start, 0);
+    EXPECT_EQ(m.end, text.size());
+
+    // the leftmost start wins over a shorter match inside it
+    Compiled<DFA> d("abcd|c");
+    auto res = d.engine.find_all("xabcdc");
+    ASSERT_EQ(res.size(), 2);
+    EXPECT_EQ(res[0].start, 1);
+    EXPECT_EQ(res[0].end, 5);
+    EXPECT_EQ(res[1].start, 5);
+}
+
+TEST(DFA, literals) {
+    using Strs = std::vector<std::string>;
+    NFA a = compile_nfa("[a-zA-Z0-9]+@[a-zA-Z0-9]+\\.[a-zA-Z0-9]+");
+    EXPECT_TRUE(a.get_literals().prefixes.empty());
+    EXPECT_EQ(a.get_literals().inner, "@");
+
+    NFA b = compile_nfa("https?://[a-z]+");
+    EXPECT_EQ(b.get_literals().prefixes, Strs({"http://", "https://"}));
+    EXPECT_TRUE(b.get_literals().suffixes.empty());
+    EXPECT_EQ(b.get_literals().inner, "http");
+
+    NFA c = compile_nfa("(foo|bar)+baz");
+    EXPECT_EQ(c.get_literals().prefixes, Strs({"bar", "foo"}));
+    EXPECT_EQ(c.get_literals().suffixes, Strs({"barbaz", "foobaz"}));
+    EXPECT_EQ(c.get_literals().inner, "baz");
+
+    NFA d = compile_nfa("(ab){2,3}d");
+    EXPECT_EQ(d.get_literals().prefixes, Strs({"abababd", "ababd"}));
+    EXPECT_EQ(d.get_literals().inner, "ababd");
+
+    // a match may be empty
+    EXPECT_TRUE(compile_nfa("a|b*").get_literals().empty());
+}
+
+TEST(DFA, prefilter) {
+    Compiled<DFA> c("[a-z]+@[a-z]+\\.com");
+    Match m;
+    EXPECT_FALSE(c.engine.search("no address here", m));
+    EXPECT_TRUE(c.engine.search("mail bob@example.com, ann@x.com", m));
+    EXPECT_EQ(m.start, 5);
+    EXPECT_EQ(m.end, 20);
+    EXPECT_EQ(c.engine.find_all("mail bob@example.com, ann@x.com").size(), 2);
+
+    // candidates without a match fall back to the backward scan
+    std::string text(40000, 'a');
+    Compiled<DFA> d("a[a-z]*b");
+    LazyDFA lazy(&d.nfa);
+    EXPECT_FALSE(d.engine.search(text, m));
+    EXPECT_FALSE(lazy.search(text, m));
+    text += "b";
+    EXPECT_TRUE(d.engine.search(text, m, 10));
+    EXPECT_EQ(m.start, 10);
+    EXPECT_EQ(m.end, text.size());
+
+    Compiled<DFA> e("(a[ab]c|b[bc]c|c[ac]c)");
+    auto res = e.engine.find_all("xxaacxcccbbcab");
+    ASSERT_EQ(res.size(), 3);
+    EXPECT_EQ(res[0].start, 2);
+    EXPECT_EQ(res[1].start, 6);
+    EXPECT_EQ(res[2].start, 9);
+}
+
+// backward start scans over windows growing from the search position
+TEST(DFA, search_windows) {
+    EXPECT_EQ(compile_nfa("a[bc]{2,5}d|^x").max_length(), 7);
+    EXPECT_EQ(compile_nfa("$").max_length(), 0);
+    EXPECT_EQ(compile_nfa("a[bc]*d").max_length(), NO_MATCH);
+
+    std::string text(10000, 'e');
+    text.replace(5000, 5, "abbcd");
+    text.replace(9000, 4, "acbd");
+    Compiled<DFA> c("a[bc]{2,5}d|e{3}x$");
+    LazyDFA lazy(&c.nfa);
+    for (LongestMatcher* e : std::initializer_list<LongestMatcher*>{&c.engine, &lazy}) {
+        Match m;
+        ASSERT_TRUE(e->search(text, m, 100));
+        EXPECT_EQ(m.start, 5000);
+        EXPECT_EQ(m.end, 5005);
+        ASSERT_TRUE(e->search(text, m, 5001));
+        EXPECT_EQ(m.start, 9000);
+        EXPECT_FALSE(e->search(text, m, 9001));
+        // `$` holds in the last window only
+        ASSERT_TRUE(e->search(text + "x", m, 9001));
+        EXPECT_EQ(m.start, 9997);
+        EXPECT_EQ(m.end, 10001);
+        EXPECT_FALSE(e->search(text + "xe", m, 9001));
+    }
+}
+
+TEST(DFA, table) {
+    Compiled<DFA> c("[a-z]+\\d");
+    const DFATable& t = c.engine.get_table();
+    // dead, start, letters, accept
+    EXPECT_EQ(t.states(), 4);
+    // letters, digits, others
+    EXPECT_EQ(t.alphabet, 3);
+    EXPECT_EQ(t.classes['a'], t.classes['z']);
+    EXPECT_EQ(t.classes['0'], t.classes['9']);
+    EXPECT_NE(t.classes['a'], t.classes['0']);
+    EXPECT_EQ(t.trans.size(), t.states() * t.alphabet);
+
+    uint32_t s = t.next(t.initial, 'x');
+    EXPECT_NE(s, DEAD_STATE);
+    EXPECT_EQ(t.next(s, 'y'), s);
+    s = t.next(s, '7');
+    EXPECT_TRUE(t.flags[s] & DFATable::ACCEPT);
+    EXPECT_EQ(t.next(s, 'a'), DEAD_STATE);
+    EXPECT_EQ(t.next(t.initial, '-'), DEAD_STATE);
+}
+
+TEST(DFA, codegen) {
+    Compiled<DFA> c("[a-z]+\\d");
+    std::stringstream os;
+    DFACode(&c.engine, "[a-z]+\\d", "Word").dump(os);
+    std::string s = os.str();
+    EXPECT_NE(s.find("struct Word {"), std::string::npos);
+    EXPECT_NE(s.find("STATES = 4;"), std::string::npos);
+    EXPECT_NE(s.find("// class 1: [0-9]"), std::string::npos);
+    EXPECT_NE(s.find("// class 2: [a-z]"), std::string::npos);
+    // letters loop, a digit accepts
+    EXPECT_NE(s.find("static constexpr uint8_t trans[STATES][CLASSES] = {\n"
+        "        {0, 0, 0}, // dead\n"
+        "        {0, 0, 2},\n"
+        "        {0, 3, 2},\n"
+        "        {0, 0, 0},\n"), std::string::npos) << s;
+}
+
+TEST(DFA, minimize) {
+    // 2^4 suffixes to remember, plus the dead state
+    Compiled<DFA> c("(a|b)*a(a|b){3}");
+    EXPECT_EQ(c.engine.get_table().states(), 17);
+    EXPECT_TRUE(c.engine.match("bbabab"));
+    EXPECT_FALSE(c.engine.match("aabbbb"));
+
+    Compiled<DFA> d("a{300}");
+    EXPECT_EQ(d.engine.get_table().states(), 302);
+    EXPECT_TRUE(d.engine.match(std::string(300, 'a')));
+    EXPECT_FALSE(d.engine.match(std::string(299, 'a')));
+}
+
+TEST(DFA, classes) {
+    // overlapping ranges are split into disjoint byte classes
+    Compiled<DFA> c("\\d+x|[0-5]+y|[a-z]m");
+    EXPECT_TRUE(c.engine.match("19x"));
+    EXPECT_TRUE(c.engine.match("05y"));
+    EXPECT_FALSE(c.engine.match("19y"));
+    EXPECT_TRUE(c.engine.match("mm"));
+    EXPECT_TRUE(c.engine.match("am"));
+    const DFATable& t = c.engine.get_table();
+    EXPECT_EQ(t.classes['0'], t.classes['5']);
+    EXPECT_NE(t.classes['5'], t.classes['6']);
+    EXPECT_NE(t.classes['l'], t.classes['m']);
+    EXPECT_EQ(t.classes['A'], t.classes['%']);
+
+    Compiled<DFA> d("[^a-c]\\W.");
+    EXPECT_TRUE(d.engine.match("d-x"));
+    EXPECT_FALSE(d.engine.match("a-x"));
+    EXPECT_FALSE(d.engine.match("d_x"));
+    EXPECT_FALSE(d.engine.match("d-\n"));
+}
+
+TEST(DFA, all_bytes) {
+    // every byte in its own class, plus the dead class
+    std::string expr = "(?:";
+    char buf[8];
+    for (int c = 0; c < 256; c++) {
+        snprintf(buf, sizeof(buf), "\\x%02X", c);
+        expr += (c ? "|" : "") + std::string(buf);
+    }
+    expr += ")+";
+    Compiled<DFA> c(expr);
+    const DFATable& t = c.engine.get_table();
+    EXPECT_EQ(t.alphabet, 257);
+    EXPECT_NE(t.classes[0xFF], 0);
+    EXPECT_NE(t.classes[0xFF], t.classes[0xFE]);
+
+    LazyDFA lazy(&c.nfa);
+    PikeVM vm(&c.nfa);
+    for (std::string text : {std::string("\xff"), std::string("\x00\x7f\x80\xff", 4)}) {
+        EXPECT_TRUE(c.engine.match(text));
+        EXPECT_TRUE(lazy.match(text));
+        EXPECT_TRUE(vm.match(text));
+    }
+}
+
+TEST(DFA, unicode) {
+    Compiled<DFA> c("[\\u4E00-\\u9FA5]+");
+    EXPECT_TRUE(c.engine.match("\u4e2d\u6587"));
+    EXPECT_FALSE(c.engine.match("a"));
+    EXPECT_FALSE(c.engine.match("\xe4\xb8"));
+
+    Compiled<DFA> d("a.b", true);
+    EXPECT_TRUE(d.engine.match("a\u00e9b"));
+    EXPECT_TRUE(d.engine.match("a\u4e2db"));
+    EXPECT_FALSE(d.engine.match("a\xe4\xb8" "b"));
+
+    Compiled<DFA> e("a.b");
+    EXPECT_FALSE(e.engine.match("a\u00e9b"));
+    EXPECT_TRUE(e.engine.match("a\xe9" "b"));
+
+    // negated multibyte chars need -u
+    EXPECT_THROW(Compiled<DFA>("[^\\u4E00]+"), std::runtime_error);
+    Compiled<DFA> f("[^\\u4E00]+", true);
+    EXPECT_FALSE(f.engine.match("\u4e00"));
+    EXPECT_TRUE(f.engine.match("a\u4e01"));
+    EXPECT_FALSE(f.engine.match("a\u4e00"));
+}
+
+TEST(DFA, anchor) {
+    Compiled<DFA> c("^ab|c$");
+    Match m;
+    EXPECT_TRUE(c.engine.search("abx", m));
+    EXPECT_EQ(m.start, 0);
+    EXPECT_FALSE(c.engine.search("xab", m));
+    EXPECT_FALSE(c.engine.search("xcx", m));
+    EXPECT_TRUE(c.engine.search("xabc", m));
+    EXPECT_EQ(m.start, 3);
+
+    EXPECT_THROW(Compiled<DFA>("a\\bc"), std::runtime_error);
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include "Batch.h"
+#include "DFAFile.h"
+#include "RegexSet.h"
+#include "compiled.h"
+
+static std::string save(const std::string& name, const std::string& image) {
+    std::string path = testing::TempDir() + name;
+    std::ofstream(path, std::ios::binary) << image;
+    return path;
+}
+
+static std::string image_of(Compiled<DFA>& c) {
+    std::ostringstream os;
+    write_dfa_file(os, c.engine.get_table(), &c.engine.get_reversed_table(), c.nfa.max_length());
+    return os.str();
+}
+
+// the mapped image matches like the DFA it was written from
+TEST(DFAFile, same_as_dfa) {
+    std::mt19937 rng(5);
+    for (std::string expr : {"a[bc]+d|^x|y$", "(ab|b){1,3}c?", "$", "[^a]"}) {
+        Compiled<DFA> c(expr);
+        MappedDFA m(save("same.dfa", image_of(c)));
+        EXPECT_EQ(m.states(), c.engine.get_table().states());
+        EXPECT_EQ(m.patterns(), 0);
+
+        for (int round = 0; round < 200; round++) {
+            std::string text;
+            int n = rng() % 40;
+            for (int i = 0; i < n; i++) text += "abcdxy"[rng() % 6];
+            EXPECT_EQ(m.match(text), c.engine.match(text)) << expr << " " << text;
+            Match a, b;
+            size_t pos = rng() % (n + 1);
+            ASSERT_EQ(m.search(text, a, pos), c.engine.search(text, b, pos)) << expr << " " << text;
+            EXPECT_EQ(a.start, b.start) << expr << " " << text;
+            EXPECT_EQ(a.end, b.end) << expr << " " << text;
+            EXPECT_EQ(m.find_all(text).size(), c.engine.find_all(text).size()) << expr << " " << text;
+        }
+    }
+}
+
+TEST(DFAFile, pattern_set) {
+    RegexSet set;
+    set.add("abc");
+    set.add("b+");
+    set.add("c$");
+    set.compile();
+    std::ostringstream os;
+    set.save(os);
+    MappedDFA m(save("set.dfa", os.str()));
+    EXPECT_EQ(m.patterns(), 3);
+    for (std::string text : {"xabc", "abx", "", "cc"}) {
+        EXPECT_EQ(m.matches(text), set.matches(text)) << text;
+    }
+    // no reversed table to search with
+    Match match;
+    EXPECT_THROW(m.search("abc", match), std::runtime_error);
+
+    Compiled<DFA> c("abc");
+    MappedDFA single(save("single.dfa", image_of(c)));
+    EXPECT_THROW(single.matches("abc"), std::runtime_error);
+}
+
+// -b -f dfabin compiles the lines into one pattern set
+TEST(DFAFile, batch_set) {
+    Utils::Args args;
+    args.format = Utils::FMT_DFABIN;
+    args.utf8 = false;
+    args.batch = true;
+    args.jobs = 1;
+
+    std::istringstream is("abc\n\nb+\nc$\n");
+    std::stringstream os, es;
+    EXPECT_EQ(run_batch(is, os, es, args), 0);
+    MappedDFA m(save("batch.dfa", os.str()));
+    EXPECT_EQ(m.patterns(), 3);
+    EXPECT_EQ(m.matches("xabc"), std::vector<size_t>({0, 1, 2}));
+    EXPECT_EQ(m.matches("bx"), std::vector<size_t>({1}));
+
+    // nothing is written with a bad line
+    std::istringstream bad("abc\n(ab\n");
+    std::stringstream os2, es2;
+    EXPECT_EQ(run_batch(bad, os2, es2, args), 1);
+    EXPECT_TRUE(os2.str().empty());
+    EXPECT_EQ(es2.str().find("Error: line 2: "), 0);
+}
+
+TEST(DFAFile, invalid) {
+    EXPECT_THROW(MappedDFA(testing::TempDir() + "missing.dfa"), std::runtime_error);
+    EXPECT_THROW(MappedDFA(save("empty.dfa", "")), std::runtime_error);
+
+    Compiled<DFA> c("a[bc]+d");
+    std::string image = image_of(c);
+    EXPECT_NO_THROW(MappedDFA(save("ok.dfa", image)));
+
+    std::string bad = image;
+    bad[0] = 'x';
+    EXPECT_THROW(MappedDFA(save("magic.dfa", bad)), std::runtime_error);
+    bad = image;
+    ((DFAFileHeader*)&bad[0])->version++;
+    EXPECT_THROW(MappedDFA(save("version.dfa", bad)), std::runtime_error);
+    EXPECT_THROW(MappedDFA(save("short.dfa", image.substr(0, image.size() - 1))), std::runtime_error);
+
+    // a transition to a state outside the table
+    bad = image;
+    const DFAFileTable* t = (const DFAFileTable*)&bad[sizeof(DFAFileHeader)];
+    ((uint32_t*)&bad[t->trans])[1] = t->states;
+    EXPECT_THROW(MappedDFA(save("trans.dfa", bad)), std::runtime_error);
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#include "Parser.h"
+#include "LazyDFA.h"
+#include "compiled.h"
+
+static std::string spans(const std::vector<Match>& ms) {
+    std::string s;
+    for (auto& m : ms) {
+        s += "[" + std::to_string(m.start) + "," + std::to_string(m.end) + ")";
+    }
+    return s;
+}
+
+TEST(LazyDFA, same_as_dfa) {
+    std::vector<std::string> exprs = {
+        "a+b*[0-9]+", "ab|abcd|c", "[a-z]+\\d", "a*", "^ab|c$", "(a|b)*a(a|b){3}", "[^a-c]\\W.",
+    };
+    std::string text = "xab1 cd22 abcd aab09-c abbab\na-x c";
+    for (auto& expr : exprs) {
+        Compiled<DFA> c(expr);
+        LazyDFA lazy(&c.nfa);
+        EXPECT_EQ(spans(lazy.find_all(text)), spans(c.engine.find_all(text))) << expr;
+        EXPECT_EQ(lazy.match("abcd"), c.engine.match("abcd")) << expr;
+    }
+}
+
+TEST(LazyDFA, on_demand) {
+    Compiled<LazyDFA> c("[a-z]{0,62}\\.[a-z]{2,6}");
+    EXPECT_TRUE(c.engine.match("example.com"));
+    EXPECT_FALSE(c.engine.match("example"));
+    // only the states the input reached
+    EXPECT_LT(c.engine.states(), 40);
+}
+
+TEST(LazyDFA, small_cache) {
+    std::string text;
+    for (int i = 0; i < 300; i++) {
+        // a/b words spelling the bits of i
+        for (int k = i; k; k >>= 1) {
+            text += (k & 1) ? 'a' : 'b';
+        }
+        text += std::to_string(i) + " ";
+    }
+    Compiled<LazyDFA> big("(a|b)*a(a|b){6}\\d+");
+    Compiled<LazyDFA> small("(a|b)*a(a|b){6}\\d+", false, 4096);
+    auto expect = spans(big.engine.find_all(text));
+    EXPECT_FALSE(expect.empty());
+    EXPECT_EQ(spans(small.engine.find_all(text)), expect);
+    EXPECT_GT(small.engine.flushes() + small.engine.fallbacks(), 0);
+    EXPECT_EQ(big.engine.flushes(), 0);
+}
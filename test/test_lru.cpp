@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include "LruCache.h"
+
+TEST(LruCache, evict) {
+    LruCache<std::string,int> c(2);
+    int v = 0;
+    c.put("a", 1);
+    c.put("b", 2);
+    EXPECT_TRUE(c.get("a", v));
+    EXPECT_EQ(v, 1);
+    // b is the least recently used now
+    c.put("c", 3);
+    EXPECT_FALSE(c.get("b", v));
+    EXPECT_TRUE(c.get("c", v));
+    EXPECT_TRUE(c.get("a", v));
+    c.put("a", 4);
+    EXPECT_TRUE(c.get("a", v));
+    EXPECT_EQ(v, 4);
+    EXPECT_EQ(c.size(), 2);
+    EXPECT_EQ(c.hits(), 4);
+    EXPECT_EQ(c.misses(), 1);
+}
+
+TEST(LruCache, threads) {
+    LruCache<int,int> c(64);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&c, t]() {
+            int v;
+            for (int i = 0; i < 10000; i++) {
+                int k = (i * 7 + t) % 100;
+                if (c.get(k, v)) {
+                    EXPECT_EQ(v, k * 2);
+                } else {
+                    c.put(k, k * 2);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(c.hits() + c.misses(), 40000);
+    EXPECT_LE(c.size(), 64);
+}
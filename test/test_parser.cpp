@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <iostream>
+#include <thread>
 
 #include "Parser.h"
 
@@ -50,4 +51,49 @@ TEST(PARSER, regex_parse) {
     EXPECT_FALSE(root.get() == nullptr);
     EXPECT_STREQ(root->stringify().c_str(), expr.c_str());
 
-}
\ No newline at end of file
+}
+
+TEST(PARSER, arena) {
+    // nodes of a failed parse are released with its arena
+    for (auto expr : {"a{3,2}", "(ab", "[b-a]"}) {
+        EXPECT_THROW(regex_parse(expr), std::runtime_error);
+    }
+    EXPECT_EQ(Arena::current, nullptr);
+
+    std::unique_ptr<ExprRoot> root = regex_parse("(ab|c)+[0-9]");
+    ASSERT_TRUE(root->arena);
+    EXPECT_GT(root->arena->nodes(), 0);
+    EXPECT_STREQ(root->stringify().c_str(), "(ab|c)+[0-9]");
+
+    EXPECT_THROW(new Literal("x"), std::runtime_error);
+}
+
+TEST(PARSER, concurrent) {
+    std::vector<std::string> exprs = {
+        "(a[ab]c|b[bc]c|c[ac]c)", "a+b*[0-9]{2,}", "(?<year>\\d{4})-(?<m>\\d\\d)", "x|y|(z)+?",
+    };
+    std::vector<int> ok(8, 0);
+    std::vector<std::thread> threads;
+    for (size_t t=0; t<ok.size(); t++) {
+        threads.emplace_back([&, t]() {
+            for (int i=0; i<200; i++) {
+                const std::string& expr = exprs[(t + i) % exprs.size()];
+                auto root = regex_parse(expr);
+                if (root->stringify() != expr) return;
+                if (i % 50) continue;
+                // errors are reported per call
+                try {
+                    regex_parse("a{3,2}");
+                    return;
+                } catch (const std::runtime_error& e) {
+                    if (std::string(e.what()).find("{3,2}") == std::string::npos) return;
+                }
+            }
+            ok[t] = 1;
+        });
+    }
+    for (auto& th : threads) th.join();
+    for (size_t t=0; t<ok.size(); t++) {
+        EXPECT_EQ(ok[t], 1) << "thread " << t;
+    }
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#include "Parser.h"
+#include "PikeVM.h"
+#include "compiled.h"
+
+#define EXPECT_SPAN(m, a, b) do { EXPECT_EQ((m).start, a); EXPECT_EQ((m).end, b); } while (0)
+
+TEST(PikeVM, captures) {
+    Compiled<PikeVM> c("(\\d+)-(\\d+)");
+    Captures caps;
+    ASSERT_TRUE(c.engine.search("tel 12-345", caps));
+    ASSERT_EQ(caps.size(), 3);
+    EXPECT_SPAN(caps[0], 4, 10);
+    EXPECT_SPAN(caps[1], 4, 6);
+    EXPECT_SPAN(caps[2], 7, 10);
+
+    // unset group
+    Compiled<PikeVM> d("(a)|(b)");
+    ASSERT_TRUE(d.engine.search("xb", caps));
+    EXPECT_FALSE(caps.has(1));
+    EXPECT_TRUE(caps.has(2));
+    EXPECT_SPAN(caps[2], 1, 2);
+
+    // the last iteration of a repeated group
+    Compiled<PikeVM> e("(a|b)+");
+    ASSERT_TRUE(e.engine.match("abb", &caps));
+    EXPECT_SPAN(caps[1], 2, 3);
+
+    Compiled<PikeVM> f("(?:x(y))+");
+    ASSERT_TRUE(f.engine.search("xyxy", caps));
+    EXPECT_EQ(caps.size(), 2);
+    EXPECT_SPAN(caps[1], 3, 4);
+}
+
+TEST(PikeVM, named) {
+    Compiled<PikeVM> c("(?<year>\\d{4})-(?<month>\\d\\d)");
+    EXPECT_EQ(c.engine.groups(), 3);
+    EXPECT_EQ(c.engine.group_index("year"), 1);
+    EXPECT_EQ(c.engine.group_index("month"), 2);
+    EXPECT_EQ(c.engine.group_index("day"), -1);
+    Captures caps;
+    ASSERT_TRUE(c.engine.search("on 2024-05-01", caps));
+    EXPECT_SPAN(caps[c.engine.group_index("year")], 3, 7);
+    EXPECT_SPAN(caps[c.engine.group_index("month")], 8, 10);
+}
+
+TEST(PikeVM, priority) {
+    Captures caps;
+    Compiled<PikeVM> greedy("a(.*)b");
+    ASSERT_TRUE(greedy.engine.search("axbyb", caps));
+    EXPECT_SPAN(caps[1], 1, 4);
+
+    Compiled<PikeVM> lazy("a(.*?)b");
+    ASSERT_TRUE(lazy.engine.search("axbyb", caps));
+    EXPECT_SPAN(caps[1], 1, 2);
+
+    Compiled<PikeVM> lazy2("(a{2,3}?)(a*)");
+    ASSERT_TRUE(lazy2.engine.match("aaaa", &caps));
+    EXPECT_SPAN(caps[1], 0, 2);
+
+    // leftmost-first, but match() needs the whole text
+    Compiled<PikeVM> alt("a|ab");
+    ASSERT_TRUE(alt.engine.search("ab", caps));
+    EXPECT_SPAN(caps[0], 0, 1);
+    EXPECT_TRUE(alt.engine.match("ab"));
+    EXPECT_FALSE(alt.engine.match("abb"));
+
+    auto all = alt.engine.find_all("xabab");
+    ASSERT_EQ(all.size(), 2);
+    EXPECT_SPAN(all[1][0], 3, 4);
+}
+
+TEST(PikeVM, anchor) {
+    Compiled<PikeVM> c("^(a+)$|b$");
+    Captures caps;
+    EXPECT_TRUE(c.engine.search("aaa", caps));
+    EXPECT_SPAN(caps[1], 0, 3);
+    EXPECT_FALSE(c.engine.search("xaaa", caps));
+    EXPECT_TRUE(c.engine.search("aab", caps));
+    EXPECT_SPAN(caps[0], 2, 3);
+}
+
+TEST(PikeVM, no_backtracking) {
+    // exponential for backtracking engines
+    Compiled<PikeVM> c("(a*)*b");
+    EXPECT_FALSE(c.engine.match(std::string(5000, 'a')));
+
+    Compiled<PikeVM> d("(a?){30}a{30}");
+    EXPECT_TRUE(d.engine.match(std::string(30, 'a')));
+    EXPECT_FALSE(d.engine.match(std::string(29, 'a')));
+}
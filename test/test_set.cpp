@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "RegexSet.h"
+#include "compiled.h"
+
+TEST(RegexSet, matches) {
+    RegexSet set;
+    set.add("abc");
+    set.add("b+");
+    set.add("^x");
+    set.add("c$");
+    set.add("\\d{3}");
+    set.compile();
+    EXPECT_EQ(set.size(), 5);
+    EXPECT_EQ(set.matches("xabc"), std::vector<size_t>({0, 1, 2, 3}));
+    EXPECT_EQ(set.matches("abx"), std::vector<size_t>({1}));
+    EXPECT_EQ(set.matches("a12c 345"), std::vector<size_t>({4}));
+    EXPECT_EQ(set.matches(""), std::vector<size_t>());
+    EXPECT_THROW(set.add("d"), std::runtime_error);
+
+    RegexSet whole(true);
+    whole.add("a+");
+    whole.add("[ab]+");
+    whole.add("b*$");
+    whole.compile();
+    EXPECT_EQ(whole.matches("aa"), std::vector<size_t>({0, 1}));
+    EXPECT_EQ(whole.matches("ab"), std::vector<size_t>({1}));
+    EXPECT_EQ(whole.matches(""), std::vector<size_t>({2}));
+    EXPECT_EQ(whole.matches("abc"), std::vector<size_t>());
+
+    EXPECT_THROW(RegexSet().add("a("), std::runtime_error);
+}
+
+// one scan agrees with searching each pattern alone
+TEST(RegexSet, same_as_dfa) {
+    std::vector<std::string> patterns = {
+        "a[bc]+d", "^ab", "b$", "(ab|ba){2}", "c.c", "[^a]a", "a*", "dd|bab", "^$", "x",
+    };
+    RegexSet set;
+    std::vector<std::unique_ptr<Compiled<DFA>>> dfas;
+    for (auto& p : patterns) {
+        set.add(p);
+        dfas.push_back(std::make_unique<Compiled<DFA>>(p));
+    }
+    set.compile();
+
+    std::mt19937 rng(11);
+    for (int t = 0; t < 2000; t++) {
+        std::string text;
+        for (int i = rng() % 10; i > 0; i--) text += "abcd"[rng() % 4];
+        std::vector<size_t> expect;
+        Match m;
+        for (size_t p = 0; p < dfas.size(); p++) {
+            if (dfas[p]->engine.search(text, m)) expect.push_back(p);
+        }
+        EXPECT_EQ(set.matches(text), expect) << text;
+    }
+}